@@ -0,0 +1,89 @@
+#include "BackgroundLayer.h"
+
+bool BackgroundLayer::Style::operator==(const Style& other) const
+{
+    return top == other.top && bottom == other.bottom && tint == other.tint;
+}
+
+bool BackgroundLayer::Style::operator!=(const Style& other) const
+{
+    return !operator==(other);
+}
+
+BackgroundLayer::BackgroundLayer()
+{
+}
+
+BackgroundLayer::~BackgroundLayer()
+{
+}
+
+void BackgroundLayer::draw(Graphics& g, int width, int height, const Style& newStyle)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    const int64 paintStart = Time::getHighResolutionTicks();
+
+    // Drawn at the display's pixel scale so the lines stay crisp
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (width != imageWidth || height != imageHeight || scale != imageScale || newStyle != style)
+        render(width, height, scale, newStyle);
+
+    // Only the clipped area is copied
+    if (scale == 1.0f)
+        g.drawImageAt(image, 0, 0);
+    else
+        g.drawImageTransformed(image, AffineTransform::scale(1.0f / scale));
+
+    const double microseconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - paintStart) * 1.0e6;
+    averagePaintMicroseconds += 0.05 * (microseconds - averagePaintMicroseconds);
+}
+
+void BackgroundLayer::render(int width, int height, float scale, const Style& newStyle)
+{
+    const int64 renderStart = Time::getHighResolutionTicks();
+
+    imageWidth = width;
+    imageHeight = height;
+    imageScale = scale;
+    style = newStyle;
+    image = Image(Image::RGB, jmax(1, roundToInt(width * scale)), jmax(1, roundToInt(height * scale)), false);
+
+    Graphics g(image);
+    g.addTransform(AffineTransform::scale(scale));
+
+    // Gradient background
+    ColourGradient gradient(style.top, 0, 0, style.bottom, 0, (float)height, false);
+    g.setGradientFill(gradient);
+    g.fillAll();
+
+    // Subtle texture with horizontal lines
+    g.setColour(Colours::white.withAlpha(0.1f));
+    for (int y = 0; y < height; y += lineSpacing)
+        g.drawHorizontalLine(y, 0.0f, (float)width);
+
+    if (!style.tint.isTransparent())
+    {
+        g.setColour(style.tint);
+        g.fillAll();
+    }
+
+    lastRenderMicroseconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - renderStart) * 1.0e6;
+    ++numRenders;
+}
+
+double BackgroundLayer::getAveragePaintMicroseconds() const
+{
+    return averagePaintMicroseconds;
+}
+
+double BackgroundLayer::getLastRenderMicroseconds() const
+{
+    return lastRenderMicroseconds;
+}
+
+int BackgroundLayer::getNumRenders() const
+{
+    return numRenders;
+}
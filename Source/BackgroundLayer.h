@@ -0,0 +1,50 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+ * The textured background of a panel: a vertical gradient, faint scan lines
+ * every few pixels and an optional tint. It is drawn once per size, pixel
+ * scale and style into an image, so the many repaints that fall through from
+ * animated children only copy the part of the image they need.
+ * Message thread only.
+ */
+class BackgroundLayer {
+public:
+    struct Style {
+        Colour top;
+        Colour bottom;
+        Colour tint = Colours::transparentBlack;  // Filled over everything, if not transparent
+
+        bool operator==(const Style& other) const;
+        bool operator!=(const Style& other) const;
+    };
+
+    static constexpr int lineSpacing = 4;
+
+    BackgroundLayer();
+    ~BackgroundLayer();
+
+    // Fills width x height from the origin of g, drawing the image again first if needed
+    void draw(Graphics& g, int width, int height, const Style& style);
+
+    // Average time draw() takes per paint, and how long the last full redraw of the image
+    // took (what every paint cost before the image was cached)
+    double getAveragePaintMicroseconds() const;
+    double getLastRenderMicroseconds() const;
+    int getNumRenders() const;
+
+private:
+    void render(int width, int height, float scale, const Style& newStyle);
+
+    Image image;
+    int imageWidth = 0;
+    int imageHeight = 0;
+    float imageScale = 0.0f;
+    Style style;
+
+    double averagePaintMicroseconds = 0.0;
+    double lastRenderMicroseconds = 0.0;
+    int numRenders = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BackgroundLayer)
+};
@@ -0,0 +1,467 @@
+#include "BandSplitEQ.h"
+
+void BandSplitEQ::Biquad::setCoefficients(const IIRCoefficients& c)
+{
+    // IIRCoefficients are already normalised by a0
+    b0 = c.coefficients[0];
+    b1 = c.coefficients[1];
+    b2 = c.coefficients[2];
+    a1 = c.coefficients[3];
+    a2 = c.coefficients[4];
+}
+
+BandSplitEQ::BandSplitEQ()
+{
+    for (auto& gain : bandGains)
+        gain.setCurrentAndTargetValue(1.0f);
+    outputGain.setCurrentAndTargetValue(1.0f);
+    wetMix.setCurrentAndTargetValue(0.0f);
+
+    reset();
+}
+
+BandSplitEQ::~BandSplitEQ()
+{
+}
+
+void BandSplitEQ::prepare(double sampleRate, int maximumBlockSize)
+{
+    // Set up 3-band EQ with standard DJ-style crossover points
+
+    // Low band: everything below 300 Hz (bass)
+    bands[lowBand].setCoefficients(IIRCoefficients::makeLowPass(sampleRate, 300));
+
+    // Mid band: centered around 1200 Hz with Q factor 0.7
+    bands[midBand].setCoefficients(IIRCoefficients::makeBandPass(sampleRate, 1200, 0.7));
+
+    // High band: everything above 2500 Hz (treble)
+    bands[highBand].setCoefficients(IIRCoefficients::makeHighPass(sampleRate, 2500));
+
+    // Every lane of a band runs the same coefficients, one channel each
+    for (int band = 0; band < numBands; ++band)
+    {
+        for (auto& lanes : laneBands[band])
+        {
+            lanes.b0 = Vec::expand(bands[band].b0);
+            lanes.b1 = Vec::expand(bands[band].b1);
+            lanes.b2 = Vec::expand(bands[band].b2);
+            lanes.a1 = Vec::expand(bands[band].a1);
+            lanes.a2 = Vec::expand(bands[band].a2);
+        }
+    }
+
+    // Size the band buffers once, the audio callback only ever reuses them
+    maxBlockSize = jmax(1, maximumBlockSize);
+    bandBuffers.setSize(numBands, maxBlockSize, false, true, false);
+    gainRamps.setSize(numBands + 1, maxBlockSize, false, true, false);
+    frameStorage.calloc((size_t)(maxBlockSize * laneWidth + laneWidth));
+    frames = Vec::getNextSIMDAlignedPtr(frameStorage.get());
+    dryBuffer.setSize(maxChannels, maxBlockSize, false, true, false);
+    wetRamp.setSize(1, maxBlockSize, false, true, false);
+
+    // Ramp lengths are counted in samples, so they follow the sample rate
+    currentSampleRate = sampleRate;
+    appliedRampLengthSeconds = 0.0;
+
+    reset();
+}
+
+void BandSplitEQ::releaseResources()
+{
+    bandBuffers.setSize(0, 0);
+    gainRamps.setSize(0, 0);
+    frameStorage.free();
+    frames = nullptr;
+    dryBuffer.setSize(0, 0);
+    wetRamp.setSize(0, 0);
+    maxBlockSize = 0;
+}
+
+void BandSplitEQ::reset()
+{
+    for (int band = 0; band < numBands; ++band)
+    {
+        for (int channel = 0; channel < maxChannels; ++channel)
+        {
+            state1[band][channel] = 0.0f;
+            state2[band][channel] = 0.0f;
+        }
+    }
+
+    for (auto& band : laneBands)
+    {
+        for (auto& lanes : band)
+        {
+            lanes.s1 = Vec::expand(0.0f);
+            lanes.s2 = Vec::expand(0.0f);
+        }
+    }
+}
+
+void BandSplitEQ::setBandGains(float low, float mid, float high)
+{
+    bandGains[lowBand].setTargetValue(low);
+    bandGains[midBand].setTargetValue(mid);
+    bandGains[highBand].setTargetValue(high);
+}
+
+void BandSplitEQ::setOutputGain(float gain)
+{
+    outputGain.setTargetValue(gain);
+}
+
+void BandSplitEQ::setRampLengthSeconds(double seconds)
+{
+    rampLengthSeconds = jmax(0.0, seconds);
+}
+
+double BandSplitEQ::getRampLengthSeconds() const
+{
+    return rampLengthSeconds;
+}
+
+bool BandSplitEQ::isNeutral() const
+{
+    for (auto& gain : bandGains)
+    {
+        if (gain.isSmoothing() || gain.getTargetValue() != 1.0f)
+            return false;
+    }
+
+    return true;
+}
+
+void BandSplitEQ::setKernel(Kernel newKernel)
+{
+    kernel = newKernel;
+}
+
+BandSplitEQ::Kernel BandSplitEQ::getKernel() const
+{
+    return kernel;
+}
+
+double BandSplitEQ::getAverageProcessMicroseconds() const
+{
+    return averageMicroseconds;
+}
+
+void BandSplitEQ::process(AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    // Not prepared yet
+    if (maxBlockSize == 0)
+        return;
+
+    // Filter tails decay into denormals, which are very slow on x86
+    ScopedNoDenormals noDenormals;
+    const auto startTicks = Time::getHighResolutionTicks();
+
+    // A new ramp length applies straight away, jumping to the current targets
+    const double rampLength = rampLengthSeconds;
+    if (rampLength != appliedRampLengthSeconds)
+    {
+        for (auto& gain : bandGains)
+            gain.reset(currentSampleRate, rampLength);
+        outputGain.reset(currentSampleRate, rampLength);
+        wetMix.reset(currentSampleRate, rampLength);
+        appliedRampLengthSeconds = rampLength;
+    }
+
+    const Kernel kernelToUse = kernel;
+    if (kernelToUse != stateKernel)
+        moveStateTo(kernelToUse);
+
+    // Hosts may hand us a bigger block than announced, so work in prepared-size chunks
+    for (int offset = 0; offset < numSamples; offset += maxBlockSize)
+    {
+        const int numThisTime = jmin(maxBlockSize, numSamples - offset);
+        const int chunkStart = startSample + offset;
+
+        // Once the bands are neutral and the filtered signal has faded out, the filters are skipped
+        wetMix.setTargetValue(isNeutral() ? 0.0f : 1.0f);
+        const bool bypass = !wetMix.isSmoothing() && wetMix.getCurrentValue() == 0.0f;
+
+        // Only work out per-sample gains while something is actually moving
+        bool ramping = outputGain.isSmoothing();
+        for (auto& gain : bandGains)
+            ramping = ramping || gain.isSmoothing();
+
+        if (ramping)
+            fillGainRamps(numThisTime);
+
+        if (bypass)
+        {
+            // The signal only gets the output gain, and the filter history goes stale
+            bypassed = true;
+            applyOutputGain(buffer, chunkStart, numThisTime, ramping);
+            continue;
+        }
+
+        // Coming out of bypass, the filters start from silence while the dry signal still plays
+        if (bypassed)
+        {
+            reset();
+            bypassed = false;
+        }
+
+        const bool fading = wetMix.isSmoothing();
+        const int numChannels = jmin(buffer.getNumChannels(), (int)maxChannels);
+        if (fading)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                dryBuffer.copyFrom(channel, 0, buffer, channel, chunkStart, numThisTime);
+        }
+
+        if (kernelToUse == Kernel::simd)
+            processSimd(buffer, chunkStart, numThisTime, ramping);
+        else
+            processScalar(buffer, chunkStart, numThisTime, ramping);
+
+        if (fading)
+            mixWithDry(buffer, chunkStart, numThisTime, ramping);
+
+        // Channels without filter state still get the deck volume, as they do in bypass
+        if (buffer.getNumChannels() > maxChannels)
+            applyOutputGain(buffer, chunkStart, numThisTime, ramping, maxChannels);
+    }
+
+    // Smoothed block time, so switching kernels shows up after a few blocks
+    const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1.0e6;
+    averageMicroseconds = averageMicroseconds + 0.05 * (elapsed - averageMicroseconds);
+}
+
+void BandSplitEQ::moveStateTo(Kernel newKernel)
+{
+    // Channel n is lane n % laneWidth of group n / laneWidth
+    for (int band = 0; band < numBands; ++band)
+    {
+        for (int channel = 0; channel < maxChannels; ++channel)
+        {
+            auto& lanes = laneBands[band][channel / laneWidth];
+            const auto lane = (size_t)(channel % laneWidth);
+
+            if (newKernel == Kernel::simd)
+            {
+                lanes.s1.set(lane, state1[band][channel]);
+                lanes.s2.set(lane, state2[band][channel]);
+            }
+            else
+            {
+                state1[band][channel] = lanes.s1.get(lane);
+                state2[band][channel] = lanes.s2.get(lane);
+            }
+        }
+    }
+
+    stateKernel = newKernel;
+}
+
+void BandSplitEQ::fillGainRamps(int numSamples)
+{
+    float* low = gainRamps.getWritePointer(lowBand);
+    float* mid = gainRamps.getWritePointer(midBand);
+    float* high = gainRamps.getWritePointer(highBand);
+    float* output = gainRamps.getWritePointer(numBands);
+
+    // The output gain is folded into every band, so the mix needs one multiply per band
+    for (int i = 0; i < numSamples; ++i)
+    {
+        output[i] = outputGain.getNextValue();
+        low[i] = bandGains[lowBand].getNextValue() * output[i];
+        mid[i] = bandGains[midBand].getNextValue() * output[i];
+        high[i] = bandGains[highBand].getNextValue() * output[i];
+    }
+}
+
+void BandSplitEQ::applyOutputGain(AudioBuffer<float>& buffer, int startSample, int numSamples, bool ramping, int firstChannel)
+{
+    if (ramping)
+    {
+        for (int channel = firstChannel; channel < buffer.getNumChannels(); ++channel)
+            FloatVectorOperations::multiply(buffer.getWritePointer(channel, startSample),
+                gainRamps.getReadPointer(numBands), numSamples);
+    }
+    else if (outputGain.getTargetValue() != 1.0f)
+    {
+        for (int channel = firstChannel; channel < buffer.getNumChannels(); ++channel)
+            buffer.applyGain(channel, startSample, numSamples, outputGain.getTargetValue());
+    }
+}
+
+void BandSplitEQ::mixWithDry(AudioBuffer<float>& buffer, int startSample, int numSamples, bool ramping)
+{
+    const int numChannels = jmin(buffer.getNumChannels(), (int)maxChannels);
+    float* wet = wetRamp.getWritePointer(0);
+    for (int i = 0; i < numSamples; ++i)
+        wet[i] = wetMix.getNextValue();
+
+    // The filtered signal already has the output gain, the dry copy gets it here
+    const float* outputRamp = gainRamps.getReadPointer(numBands);
+    const float output = outputGain.getTargetValue();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* data = buffer.getWritePointer(channel, startSample);
+        const float* dry = dryBuffer.getReadPointer(channel);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float gainedDry = dry[i] * (ramping ? outputRamp[i] : output);
+            data[i] = gainedDry + wet[i] * (data[i] - gainedDry);
+        }
+    }
+}
+
+void BandSplitEQ::processScalar(AudioBuffer<float>& buffer, int startSample, int numSamples, bool ramping)
+{
+    const int numChannels = jmin(buffer.getNumChannels(), (int)maxChannels);
+    const float output = outputGain.getTargetValue();
+    const float gains[numBands] = { bandGains[lowBand].getTargetValue() * output,
+                                    bandGains[midBand].getTargetValue() * output,
+                                    bandGains[highBand].getTargetValue() * output };
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* data = buffer.getWritePointer(channel, startSample);
+
+        // Run each band's filter over its own copy of the channel
+        for (int band = 0; band < numBands; ++band)
+        {
+            const Biquad& c = bands[band];
+            float* out = bandBuffers.getWritePointer(band);
+            float s1 = state1[band][channel];
+            float s2 = state2[band][channel];
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float in = data[i];
+                const float y = c.b0 * in + s1;
+                s1 = c.b1 * in - c.a1 * y + s2;
+                s2 = c.b2 * in - c.a2 * y;
+                out[i] = y;
+            }
+
+            state1[band][channel] = s1;
+            state2[band][channel] = s2;
+        }
+
+        const float* low = bandBuffers.getReadPointer(lowBand);
+        const float* mid = bandBuffers.getReadPointer(midBand);
+        const float* high = bandBuffers.getReadPointer(highBand);
+
+        // Mix the gained bands back into the channel
+        if (ramping)
+        {
+            const float* lowGain = gainRamps.getReadPointer(lowBand);
+            const float* midGain = gainRamps.getReadPointer(midBand);
+            const float* highGain = gainRamps.getReadPointer(highBand);
+
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = low[i] * lowGain[i] + mid[i] * midGain[i] + high[i] * highGain[i];
+        }
+        else
+        {
+            FloatVectorOperations::copyWithMultiply(data, low, gains[lowBand], numSamples);
+            FloatVectorOperations::addWithMultiply(data, mid, gains[midBand], numSamples);
+            FloatVectorOperations::addWithMultiply(data, high, gains[highBand], numSamples);
+        }
+    }
+}
+
+void BandSplitEQ::processSimd(AudioBuffer<float>& buffer, int startSample, int numSamples, bool ramping)
+{
+    const int numChannels = jmin(buffer.getNumChannels(), (int)maxChannels);
+    const float output = outputGain.getTargetValue();
+    const Vec lowGain = Vec::expand(bandGains[lowBand].getTargetValue() * output);
+    const Vec midGain = Vec::expand(bandGains[midBand].getTargetValue() * output);
+    const Vec highGain = Vec::expand(bandGains[highBand].getTargetValue() * output);
+    const float* lowRamp = gainRamps.getReadPointer(lowBand);
+    const float* midRamp = gainRamps.getReadPointer(midBand);
+    const float* highRamp = gainRamps.getReadPointer(highBand);
+
+    // Up to laneWidth channels run together, one per lane, so the three bands are three
+    // independent vector recursions and nothing is broadcast or summed across lanes
+    for (int group = 0; group * laneWidth < numChannels; ++group)
+    {
+        const int firstChannel = group * laneWidth;
+        const int numLanes = jmin(laneWidth, numChannels - firstChannel);
+
+        // Interleave the group's channels into frames, unused lanes stay silent
+        for (int lane = 0; lane < laneWidth; ++lane)
+        {
+            const float* data = lane < numLanes ? buffer.getReadPointer(firstChannel + lane, startSample) : nullptr;
+            for (int i = 0; i < numSamples; ++i)
+                frames[i * laneWidth + lane] = data != nullptr ? data[i] : 0.0f;
+        }
+
+        // Local copies keep coefficients and state in registers for the whole chunk
+        LaneBiquad low = laneBands[lowBand][group];
+        LaneBiquad mid = laneBands[midBand][group];
+        LaneBiquad high = laneBands[highBand][group];
+
+        if (ramping)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                float* frame = frames + i * laneWidth;
+                const Vec in = Vec::fromRawArray(frame);
+                const Vec out = low.process(in) * Vec::expand(lowRamp[i])
+                    + mid.process(in) * Vec::expand(midRamp[i])
+                    + high.process(in) * Vec::expand(highRamp[i]);
+                out.copyToRawArray(frame);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                float* frame = frames + i * laneWidth;
+                const Vec in = Vec::fromRawArray(frame);
+                const Vec out = low.process(in) * lowGain + mid.process(in) * midGain + high.process(in) * highGain;
+                out.copyToRawArray(frame);
+            }
+        }
+
+        laneBands[lowBand][group] = low;
+        laneBands[midBand][group] = mid;
+        laneBands[highBand][group] = high;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            float* data = buffer.getWritePointer(firstChannel + lane, startSample);
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = frames[i * laneWidth + lane];
+        }
+    }
+}
+
+double BandSplitEQ::measureNanosecondsPerSample(Kernel kernelToMeasure, int numChannels, int blockSize)
+{
+    const double sampleRate = 44100.0;
+    blockSize = jmax(1, blockSize);
+
+    BandSplitEQ eq;
+    eq.setKernel(kernelToMeasure);
+    eq.prepare(sampleRate, blockSize);
+    eq.setBandGains(0.8f, 1.2f, 0.9f);
+
+    AudioBuffer<float> buffer(jmax(1, numChannels), blockSize);
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        for (int i = 0; i < blockSize; ++i)
+            buffer.setSample(channel, i, 0.5f * std::sin(0.05f * (float)(i + 7 * channel)));
+
+    // Two seconds' worth of blocks, after enough for the bypass fade to finish
+    const int numWarmUpBlocks = jmax(10, (int)(2.0 * defaultRampLengthSeconds * sampleRate / blockSize) + 1);
+    const int numBlocks = jmax(20, (int)(2.0 * sampleRate / blockSize));
+    int64 ticksSpent = 0;
+
+    for (int block = 0; block < numWarmUpBlocks + numBlocks; ++block)
+    {
+        const auto startTicks = Time::getHighResolutionTicks();
+        eq.process(buffer, 0, blockSize);
+        if (block >= numWarmUpBlocks)
+            ticksSpent += Time::getHighResolutionTicks() - startTicks;
+    }
+
+    return Time::highResolutionTicksToSeconds(ticksSpent) * 1.0e9 / ((double)numBlocks * blockSize);
+}
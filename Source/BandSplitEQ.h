@@ -0,0 +1,139 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+ * Three-band DJ EQ: splits the signal into low/mid/high bands, applies a gain
+ * to each band and sums them back into the buffer.
+ * Also applies the deck's output gain. Band and output gains are smoothed
+ * per sample and folded into the band mix, so ramps cost no extra pass over
+ * the buffer and slider moves never step once per block.
+ * Every channel keeps its own filter state for every band, so left and right
+ * never bleed into each other. Two interchangeable kernels are available:
+ *  - scalar: one band at a time through preallocated band buffers
+ *  - simd:   channels side by side in SIMDRegister lanes, all three bands in one
+ *            pass, so each band is a single vector recursion for the whole group
+ * The filter history moves with the kernel when switching, so the signal runs on
+ * without a click. All storage is sized in prepare(), so process() runs in fixed memory
+ * and is safe to call from the audio thread.
+ */
+class BandSplitEQ {
+public:
+    enum class Kernel { scalar, simd };
+
+    // Channels with their own filter state, anything beyond only gets the output gain
+    static constexpr int maxChannels = 8;
+
+    BandSplitEQ();
+    ~BandSplitEQ();
+
+    // Computes the crossover filters and sizes the band buffers (not real-time safe)
+    void prepare(double sampleRate, int maximumBlockSize);
+    void releaseResources();
+
+    // Clears the filter history, e.g. after a seek or when loading a new track
+    void reset();
+
+    // Band gains (1.0 = neutral, <1.0 = cut, >1.0 = boost), ramped towards per sample
+    void setBandGains(float low, float mid, float high);
+    // Gain applied after the EQ (the deck volume), ramped the same way
+    void setOutputGain(float gain);
+
+    // How long gain changes take to reach their target, default 20 ms
+    void setRampLengthSeconds(double seconds);
+    double getRampLengthSeconds() const;
+
+    // True when all bands are neutral and settled. The filtered signal then fades out
+    // over the ramp length, after which only the output gain is applied.
+    bool isNeutral() const;
+
+    // Selects the processing kernel, takes effect on the next block
+    void setKernel(Kernel newKernel);
+    Kernel getKernel() const;
+
+    // Average time spent in process() per block, to compare the kernels on a deck
+    double getAverageProcessMicroseconds() const;
+
+    // Filters and gains the given range of every channel in place, never allocates
+    void process(AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // Times one kernel with every band active, in ns per sample frame (all channels)
+    static double measureNanosecondsPerSample(Kernel kernelToMeasure, int numChannels = 2, int blockSize = 512);
+
+    static constexpr double defaultRampLengthSeconds = 0.02;
+
+private:
+    enum { lowBand = 0, midBand, highBand, numBands };
+
+    using Vec = dsp::SIMDRegister<float>;
+    static constexpr int laneWidth = (int)Vec::SIMDNumElements;
+    static constexpr int numLaneGroups = (maxChannels + laneWidth - 1) / laneWidth;
+
+    // Transposed direct form II biquad, as used by IIRFilter
+    struct Biquad {
+        float b0 = 0, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        void setCoefficients(const IIRCoefficients& c);
+    };
+
+    // The same biquad in every lane, each lane with its own state
+    struct LaneBiquad {
+        Vec b0, b1, b2, a1, a2;
+        Vec s1, s2;
+        Vec process(Vec in) noexcept
+        {
+            const Vec y = b0 * in + s1;
+            s1 = b1 * in - a1 * y + s2;
+            s2 = b2 * in - a2 * y;
+            return y;
+        }
+    };
+
+    // Advances the smoothers over one chunk, writing the combined band * output gains
+    void fillGainRamps(int numSamples);
+    void applyOutputGain(AudioBuffer<float>& buffer, int startSample, int numSamples, bool ramping, int firstChannel = 0);
+    // Fades between the dry copy and the filtered signal while going in or out of bypass
+    void mixWithDry(AudioBuffer<float>& buffer, int startSample, int numSamples, bool ramping);
+
+    // Both kernels work on chunks of at most maxBlockSize samples
+    void processScalar(AudioBuffer<float>& buffer, int startSample, int numSamples, bool ramping);
+    void processSimd(AudioBuffer<float>& buffer, int startSample, int numSamples, bool ramping);
+    // Hands the filter history over to the other kernel, so switching doesn't click
+    void moveStateTo(Kernel newKernel);
+
+    // Scalar kernel: coefficients per band, state per band and channel
+    Biquad bands[numBands];
+    float state1[numBands][maxChannels] = {};
+    float state2[numBands][maxChannels] = {};
+
+    // SIMD kernel: per band, one LaneBiquad for every group of laneWidth channels,
+    // and the group's channels interleaved into frames of laneWidth samples
+    LaneBiquad laneBands[numBands][numLaneGroups];
+    HeapBlock<float> frameStorage;
+    float* frames = nullptr;
+
+    // One scratch channel per band for the scalar kernel, preallocated to the largest expected block
+    AudioBuffer<float> bandBuffers;
+    int maxBlockSize = 0;
+    double currentSampleRate = 0.0;
+
+    // Per-sample gains while ramping: one row per band plus the output gain
+    SmoothedValue<float> bandGains[numBands];
+    SmoothedValue<float> outputGain;
+    AudioBuffer<float> gainRamps;
+
+    // Share of the filtered signal, faded over the ramp length so going in and out of
+    // bypass never jumps, with the unfiltered input kept alongside while it fades
+    SmoothedValue<float> wetMix;
+    AudioBuffer<float> dryBuffer;
+    AudioBuffer<float> wetRamp;
+    bool bypassed = true;
+
+    std::atomic<double> rampLengthSeconds{ defaultRampLengthSeconds };
+    double appliedRampLengthSeconds = 0.0;
+
+    std::atomic<Kernel> kernel{ Kernel::simd };
+    Kernel stateKernel = Kernel::simd;   // Whose state is current, audio thread only
+    std::atomic<double> averageMicroseconds{ 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BandSplitEQ)
+};
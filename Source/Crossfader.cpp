@@ -0,0 +1,136 @@
+#include "Crossfader.h"
+
+Crossfader::Crossfader()
+{
+    // Tables only depend on the curve, so they are built once
+    const Curve curves[numCurves] = { Curve::constantPower, Curve::linear, Curve::cut };
+    for (int c = 0; c < numCurves; ++c)
+    {
+        for (int i = 0; i <= tableSize; ++i)
+            tables[c][i] = computeGain(curves[c], (float)i / (float)tableSize, true);
+    }
+
+    smoothedPosition.setCurrentAndTargetValue(position);
+    curveMix.setCurrentAndTargetValue(1.0f);
+}
+
+Crossfader::~Crossfader()
+{
+}
+
+float Crossfader::computeGain(Curve curveToUse, float faderPosition, bool rightSide)
+{
+    // The right side sees the fader from the other end
+    const float x = jlimit(0.0f, 1.0f, rightSide ? faderPosition : 1.0f - faderPosition);
+
+    switch (curveToUse)
+    {
+        case Curve::linear:
+            return x;
+        case Curve::cut:
+            // Full level until the last 5% of travel, then a short linear cut
+            return jmin(1.0f, x / 0.05f);
+        default:
+            return std::sin(x * MathConstants<float>::halfPi);
+    }
+}
+
+void Crossfader::setPosition(float newPosition)
+{
+    position = jlimit(0.0f, 1.0f, newPosition);
+}
+
+float Crossfader::getPosition() const
+{
+    return position;
+}
+
+void Crossfader::setCurve(Curve newCurve)
+{
+    curve = newCurve;
+}
+
+Crossfader::Curve Crossfader::getCurve() const
+{
+    return curve;
+}
+
+void Crossfader::prepare(double sampleRate, int maximumBlockSize)
+{
+    maxBlockSize = jmax(1, maximumBlockSize);
+
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    const int rowLength = (maxBlockSize + simdWidth - 1) / simdWidth * simdWidth;
+    gainStorage.calloc((size_t)(3 * rowLength + simdWidth));
+
+    float* base = Vec::getNextSIMDAlignedPtr(gainStorage.get());
+    for (int row = 0; row < 3; ++row)
+        gains[row] = base + row * rowLength;
+    FloatVectorOperations::fill(gains[(int)Assignment::thru], 1.0f, rowLength);
+
+    smoothedPosition.reset(sampleRate, rampLengthSeconds);
+    smoothedPosition.setCurrentAndTargetValue(position);
+    curveMix.reset(sampleRate, rampLengthSeconds);
+    curveMix.setCurrentAndTargetValue(1.0f);
+    appliedCurve = previousCurve = curve;
+
+    // Start with the right gains in case the first block doesn't ramp
+    FloatVectorOperations::fill(gains[(int)Assignment::left], lookUp(tables[(int)appliedCurve], 1.0f - position), rowLength);
+    FloatVectorOperations::fill(gains[(int)Assignment::right], lookUp(tables[(int)appliedCurve], position), rowLength);
+}
+
+float Crossfader::lookUp(const float* table, float faderPosition) const
+{
+    // Linear interpolation between the two nearest entries
+    const float index = jlimit(0.0f, 1.0f, faderPosition) * (float)tableSize;
+    const int i = jmin((int)index, tableSize - 1);
+    return table[i] + (index - (float)i) * (table[i + 1] - table[i]);
+}
+
+void Crossfader::fillGains(int numSamples)
+{
+    jassert(numSamples <= maxBlockSize);
+    numSamples = jmin(numSamples, maxBlockSize);
+
+    smoothedPosition.setTargetValue(position);
+
+    // A new curve fades in over the ramp time, starting from whatever was playing
+    const Curve newCurve = curve;
+    if (newCurve != appliedCurve)
+    {
+        previousCurve = appliedCurve;
+        appliedCurve = newCurve;
+        curveMix.setCurrentAndTargetValue(0.0f);
+        curveMix.setTargetValue(1.0f);
+    }
+
+    const float* table = tables[(int)appliedCurve];
+    float* left = gains[(int)Assignment::left];
+    float* right = gains[(int)Assignment::right];
+
+    // Settled: the whole block has the same gains
+    if (!smoothedPosition.isSmoothing() && !curveMix.isSmoothing())
+    {
+        const float p = smoothedPosition.getCurrentValue();
+        FloatVectorOperations::fill(left, lookUp(table, 1.0f - p), numSamples);
+        FloatVectorOperations::fill(right, lookUp(table, p), numSamples);
+        return;
+    }
+
+    const float* previousTable = tables[(int)previousCurve];
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // The table holds the right side's gain, the left side reads it mirrored
+        const float p = smoothedPosition.getNextValue();
+        const float mix = curveMix.getNextValue();
+        const float newLeft = lookUp(table, 1.0f - p);
+        const float newRight = lookUp(table, p);
+        left[i] = newLeft + (1.0f - mix) * (lookUp(previousTable, 1.0f - p) - newLeft);
+        right[i] = newRight + (1.0f - mix) * (lookUp(previousTable, p) - newRight);
+    }
+}
+
+const float* Crossfader::getGains(Assignment assignment) const
+{
+    return gains[(int)assignment];
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+ * Crossfader stage of the mix bus, separate from each deck's volume.
+ * The fader position is smoothed per sample on the audio thread and turned
+ * into a left and a right gain through a precomputed curve table, so
+ * switching curves or moving the fader never clicks and costs no maths
+ * beyond a table lookup per sample.
+ *  - constantPower: sin/cos law, no level dip in the middle of a fade
+ *  - linear:        gains add up to one, dips by 6 dB in the middle
+ *  - cut:           both sides stay at full level until the last few percent of travel
+ */
+class Crossfader {
+public:
+    enum class Curve { constantPower, linear, cut };
+
+    // Which side of the fader a deck is on; thru decks ignore it
+    enum class Assignment { left, right, thru };
+
+    Crossfader();
+    ~Crossfader();
+
+    // 0 = full left, 1 = full right (any thread)
+    void setPosition(float newPosition);
+    float getPosition() const;
+
+    // Takes effect on the next block, ramped like a fader move (any thread)
+    void setCurve(Curve newCurve);
+    Curve getCurve() const;
+
+    // Sizes the gain buffers (not real-time safe)
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    // Advances the fader over numSamples and fills the per-sample gains for each side.
+    // Never allocates; numSamples must not exceed the prepared block size.
+    void fillGains(int numSamples);
+
+    // Gains written by the last fillGains, SIMD-aligned and padded to the SIMD width
+    const float* getGains(Assignment assignment) const;
+
+    // Gain of one side at a fader position for a curve, straight from the formula
+    static float computeGain(Curve curve, float position, bool rightSide);
+
+    static constexpr double rampLengthSeconds = 0.02;
+
+private:
+    using Vec = dsp::SIMDRegister<float>;
+
+    // Right-side gain by position, with one extra entry so the lookup can interpolate at 1.0.
+    // The left side is the same curve mirrored.
+    static constexpr int tableSize = 1024;
+    static constexpr int numCurves = 3;
+    float tables[numCurves][tableSize + 1];
+
+    float lookUp(const float* table, float position) const;
+
+    std::atomic<float> position{ 0.5f };
+    std::atomic<Curve> curve{ Curve::constantPower };
+
+    // Audio thread: the fader travels smoothly, a curve change crossfades between the two tables
+    SmoothedValue<float> smoothedPosition;
+    SmoothedValue<float> curveMix;
+    Curve appliedCurve = Curve::constantPower;
+    Curve previousCurve = Curve::constantPower;
+
+    HeapBlock<float> gainStorage;
+    float* gains[3] = {};  // Left, right and a row of ones for thru decks
+    int maxBlockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Crossfader)
+};
@@ -1,145 +1,445 @@
 #include "DJAudioPlayer.h"
+#include "RealtimeAllocationGuard.h"
 using namespace std;
 
-DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager)
-    : formatManager(_formatManager)
+DJAudioPlayer::DJAudioPlayer()
 {
-    // No other initialization needed - set up of the audio chain will be done when prepareToPlay is called
+    // Set up of the audio chain will be done when prepareToPlay is called,
+    // the timer only runs while a load or a held-back command is on its way
 }
 
 DJAudioPlayer::~DJAudioPlayer()
 {
-    // Smart pointers handle cleanup of the audio sources
+    // The audio device is shut down by now, so queued and retired tracks can be freed here
+    stopTimer();
+
+    Command command;
+    while (commands.pop(command))
+        delete command.track;
+
+    for (auto& held : heldCommands)
+        delete held.track;
+
+    collectRetiredTracks();
+    activeTrack = nullptr;
+    delete currentTrack;
 }
 
 void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double _sampleRate)
 {
     // Pass preparation call down the audio source chain
-    transportSource.prepareToPlay(samplesPerBlockExpected, _sampleRate);
     resampleSource.prepareToPlay(samplesPerBlockExpected, _sampleRate);
+    timeStretch.prepareToPlay(samplesPerBlockExpected, _sampleRate);
+
+    if (currentTrack != nullptr)
+        currentTrack->prepareToPlay(samplesPerBlockExpected, _sampleRate);
+
+    // The audio callback is stopped while the device changes, so tracks still
+    // waiting in the queue can be prepared here rather than on the audio thread
+    commands.forEachReady([&](Command& command)
+    {
+        if (command.track != nullptr && !command.track->isPreparedFor(samplesPerBlockExpected, _sampleRate))
+            command.track->prepareToPlay(samplesPerBlockExpected, _sampleRate);
+    });
 
-    // Store sample rate for filter calculations
+    // Store the settings for filter calculations and for preparing new tracks
     sampleRate = _sampleRate;
+    blockSize = samplesPerBlockExpected;
+    appliedRatio = 0.0;
+
+    // Loop seams only ever reuse this buffer
+    seamTail.setSize(2, maxSeamSamples);
+    seamLength = 0;
 
-    // Set up the EQ filters with crossover frequencies
-    updateFilters();
-    filtersInitialized = true;
+    // Set up the EQ crossovers and size its scratch buffers for this block size
+    eq.prepare(_sampleRate, samplesPerBlockExpected);
 }
 
-void DJAudioPlayer::updateFilters()
+void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
 {
-    // Set up 3-band EQ with standard DJ-style crossover points
+    const auto startTicks = Time::getHighResolutionTicks();
 
-    // Low band: everything below 300 Hz (bass)
-    lowFilter.setCoefficients(IIRCoefficients::makeLowPass(sampleRate, 300));
+    // Everything here runs in fixed memory, debug builds assert if that ever changes
+    const RealtimeAllocationGuard::ScopedNoAllocation noAllocation;
 
-    // Mid band: centered around 1200 Hz with Q factor 0.7
-    midFilter.setCoefficients(IIRCoefficients::makeBandPass(sampleRate, 1200, 0.7));
+    // Loads, play/stop and seeks sent since the last block
+    applyCommands();
+
+    // Switching key lock restarts the stretcher, so it never mixes audio from before the switch
+    const bool useKeyLock = keyLock;
+    if (useKeyLock != appliedKeyLock)
+    {
+        timeStretch.flushBuffers();
+        appliedKeyLock = useKeyLock;
+    }
+
+    // With key lock the stretcher changes the tempo and the resampler only converts
+    // the track's sample rate, otherwise the resampler does both (and the pitch follows)
+    if (currentTrack != nullptr && sampleRate > 0.0)
+    {
+        const double ratio = (useKeyLock ? 1.0 : (double)speed) * currentTrack->getSampleRate() / sampleRate;
+        if (ratio != appliedRatio)
+        {
+            resampleSource.setResamplingRatio(ratio);
+            appliedRatio = ratio;
+        }
+    }
+
+    if (useKeyLock)
+    {
+        timeStretch.setTempo(speed);
+        timeStretch.getNextAudioBlock(bufferToFill);
+    }
+    else
+    {
+        resampleSource.getNextAudioBlock(bufferToFill);
+    }
 
-    // High band: everything above 2500 Hz (treble)
-    highFilter.setCoefficients(IIRCoefficients::makeHighPass(sampleRate, 2500));
+    if (currentTrack != nullptr)
+        playheadSample = currentTrack->getNextReadPosition();
+    playingState = isPlaying;
+
+    // Volume and EQ are ramped per sample in the EQ's single pass over the block, the crossfader is applied in the mix.
+    // Neutral bands are bypassed there, so resetting the EQ leaves the signal untouched.
+    eq.setBandGains(lowGain, midGain, highGain);
+    eq.setOutputGain(gain);
+    eq.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+
+    // Share of the block's duration spent rendering this deck, smoothed over a few blocks
+    if (sampleRate > 0.0 && bufferToFill.numSamples > 0)
+    {
+        const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+        const double load = elapsed * sampleRate / bufferToFill.numSamples;
+        cpuLoad = cpuLoad + 0.05 * (load - cpuLoad);
+    }
 }
 
-void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+void DJAudioPlayer::applyCommands()
+{
+    // Only the last seek of a block matters, so they are applied once at the end
+    bool hasSeek = false;
+    Command seek;
+
+    Command command;
+    while (commands.peek(command))
+    {
+        if (command.type == Command::Type::load)
+        {
+            // A track prepared for another device setup is never prepared here, it goes back unplayed.
+            // Either way a track needs a slot on its way back, otherwise the load waits for the next block.
+            if (command.track->isPreparedFor(blockSize, sampleRate))
+            {
+                if (!adoptTrack(command.track))
+                    break;
+                hasSeek = false;
+            }
+            else if (!retiredTracks.push(command.track))
+            {
+                break;
+            }
+        }
+        else if (command.type == Command::Type::play)
+        {
+            isPlaying = currentTrack != nullptr;
+        }
+        else if (command.type == Command::Type::stop)
+        {
+            isPlaying = false;
+        }
+        else if (command.type == Command::Type::looping)
+        {
+            looping = command.value > 0.0;
+        }
+        else if (command.type == Command::Type::loopPoints)
+        {
+            // Converted with the rate of the track playing now, new tracks start without loop points
+            const double trackRate = currentTrack != nullptr ? currentTrack->getSampleRate() : 0.0;
+            loopStart = (int64)(jmax(0.0, command.value) * trackRate);
+            loopEnd = (int64)(jmax(0.0, command.endValue) * trackRate);
+            if (currentTrack != nullptr)
+                loopEnd = jmin(loopEnd, currentTrack->getTotalLength());
+        }
+        else
+        {
+            hasSeek = true;
+            seek = command;
+        }
+
+        commands.discardFront();
+    }
+
+    if (hasSeek && currentTrack != nullptr)
+    {
+        const int64 target = seek.type == Command::Type::seekRelative
+            ? (int64)(seek.value * (double)currentTrack->getTotalLength())
+            : (int64)(seek.value * currentTrack->getSampleRate());
+
+        currentTrack->setNextReadPosition(target);
+        resampleSource.flushBuffers();
+        timeStretch.flushBuffers();
+        seamLength = 0;
+    }
+}
+
+bool DJAudioPlayer::adoptTrack(DeckTrack* next)
 {
-    // First get the audio from the resampler (which handles our speed control)
-    resampleSource.getNextAudioBlock(bufferToFill);
+    // The message thread frees the old track, the audio thread never deletes
+    if (currentTrack != nullptr && retiredTracks.isFull())
+        return false;
+
+    // Published before the old track goes back, so the message thread never reads
+    // (or counts the underruns of) a track it may already have freed
+    DeckTrack* previous = currentTrack;
+    currentTrack = next;
+    activeTrack = next;
+
+    if (previous != nullptr)
+        retiredTracks.push(previous);
+
+    // A freshly loaded track starts stopped, at the beginning, with clean filter history
+    isPlaying = false;
+    resampleSource.flushBuffers();
+    timeStretch.flushBuffers();
+    eq.reset();
+    appliedRatio = 0.0;
+
+    playheadSample = 0;
+    trackLength = next->getTotalLength();
+    loopStart = loopEnd = 0;
+    seamLength = 0;
+    return true;
+}
 
-    // Skip EQ processing if filters aren't initialized or if all bands are neutral (allows value reset when disabling EQ)
-    if (!filtersInitialized || (lowGain == 1.0 && midGain == 1.0 && highGain == 1.0))
+void DJAudioPlayer::readTrack(const AudioSourceChannelInfo& bufferToFill)
+{
+    if (currentTrack == nullptr || !isPlaying)
+    {
+        bufferToFill.clearActiveBufferRegion();
         return;
+    }
 
-    // Get reference to the current audio buffer
-    AudioBuffer<float>& buffer = *bufferToFill.buffer;
+    const bool hasLoopPoints = loopEnd > loopStart;
+    const int64 start = hasLoopPoints ? loopStart : 0;
+    const int64 end = looping && hasLoopPoints ? loopEnd : currentTrack->getTotalLength();
+    int numDone = 0;
 
-    // Process each channel separately (for stereo or mono)
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    // Read up to the loop or track end, then wrap or stop right there inside the block
+    while (numDone < bufferToFill.numSamples)
     {
-        // Create temporary buffers for each frequency band
-        AudioBuffer<float> lowBand(1, buffer.getNumSamples());
-        AudioBuffer<float> midBand(1, buffer.getNumSamples());
-        AudioBuffer<float> highBand(1, buffer.getNumSamples());
+        const int64 position = currentTrack->getNextReadPosition();
+        const int numThisTime = (int)jlimit((int64)0, (int64)(bufferToFill.numSamples - numDone), end - position);
+
+        if (numThisTime > 0)
+        {
+            const int chunkStart = bufferToFill.startSample + numDone;
+            currentTrack->getNextAudioBlock(AudioSourceChannelInfo(bufferToFill.buffer, chunkStart, numThisTime));
+
+            if (seamPosition < seamLength)
+                applySeamFade(*bufferToFill.buffer, chunkStart, numThisTime);
+
+            numDone += numThisTime;
+        }
+
+        if (position + numThisTime < end)
+            break;
+
+        if (looping)
+        {
+            wrapLoop(start, end);
+        }
+        else
+        {
+            // End of the track: stop and rewind, the rest of the block is silent
+            AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample + numDone,
+                bufferToFill.numSamples - numDone).clearActiveBufferRegion();
+            currentTrack->setNextReadPosition(0);
+            isPlaying = false;
+            seamLength = 0;
+            return;
+        }
+    }
+}
 
-        // Copy source audio to each band buffer
-        lowBand.copyFrom(0, 0, buffer, channel, bufferToFill.startSample, buffer.getNumSamples());
-        midBand.copyFrom(0, 0, buffer, channel, bufferToFill.startSample, buffer.getNumSamples());
-        highBand.copyFrom(0, 0, buffer, channel, bufferToFill.startSample, buffer.getNumSamples());
+void DJAudioPlayer::wrapLoop(int64 loopStartSample, int64 loopEndSample)
+{
+    // Keep what would have played after the loop end, to fade it out under the loop start
+    seamLength = (int)jlimit((int64)0, (int64)seamTail.getNumSamples(),
+        jmin((int64)(seamFadeSeconds * currentTrack->getSampleRate()), (loopEndSample - loopStartSample) / 2));
+    seamPosition = 0;
 
-        // Apply the appropriate filter to each band
-        lowFilter.processSamples(lowBand.getWritePointer(0), lowBand.getNumSamples());
-        midFilter.processSamples(midBand.getWritePointer(0), midBand.getNumSamples());
-        highFilter.processSamples(highBand.getWritePointer(0), highBand.getNumSamples());
+    if (seamLength > 0)
+        currentTrack->getNextAudioBlock(AudioSourceChannelInfo(&seamTail, 0, seamLength));
 
-        // Apply gain adjustment to each band
-        lowBand.applyGain(lowGain);
-        midBand.applyGain(midGain);
-        highBand.applyGain(highGain);
+    // Cached, mapped and head audio seek for free, a streamed body refills from here
+    currentTrack->setNextReadPosition(loopStartSample);
+}
 
-        // Clear the original channel processed bands can be mixed back in
-        buffer.clear(channel, bufferToFill.startSample, buffer.getNumSamples());
+void DJAudioPlayer::applySeamFade(AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numToFade = jmin(numSamples, seamLength - seamPosition);
+    const int numChannels = jmin(buffer.getNumChannels(), seamTail.getNumChannels());
 
-        // Mix the filtered bands back into the original buffer
-        buffer.addFrom(channel, bufferToFill.startSample, lowBand, 0, 0, buffer.getNumSamples());
-        buffer.addFrom(channel, bufferToFill.startSample, midBand, 0, 0, buffer.getNumSamples());
-        buffer.addFrom(channel, bufferToFill.startSample, highBand, 0, 0, buffer.getNumSamples());
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* data = buffer.getWritePointer(channel, startSample);
+        const float* tail = seamTail.getReadPointer(channel, seamPosition);
+
+        for (int i = 0; i < numToFade; ++i)
+        {
+            const float fadeIn = (float)(seamPosition + i + 1) / (float)(seamLength + 1);
+            data[i] = data[i] * fadeIn + tail[i] * (1.0f - fadeIn);
+        }
     }
+
+    seamPosition += numToFade;
 }
 
 void DJAudioPlayer::releaseResources()
 {
     // Clean up when playback stops
     resampleSource.releaseResources();
+    timeStretch.releaseResources();
+    eq.releaseResources();
+
+    if (currentTrack != nullptr)
+        currentTrack->releaseResources();
+}
+
+void DJAudioPlayer::loadTrack(unique_ptr<DeckTrack> track)
+{
+    if (track == nullptr)
+        return;
+
+    collectRetiredTracks();
+
+    // The queue owns the track until the audio thread adopts it
+    Command command;
+    command.type = Command::Type::load;
+    command.track = track.release();
+    sendCommand(command);
+
+    // Reset EQ to neutral when loading a new track
+    resetEQ();
+}
+
+void DJAudioPlayer::timerCallback()
+{
+    serviceQueues();
+
+    // Once the audio thread has taken every command, every track it let go of has been freed
+    if (heldCommands.empty() && commands.getNumReady() == 0 && retiredTracks.getNumReady() == 0)
+        stopTimer();
+}
+
+void DJAudioPlayer::serviceQueues()
+{
+    collectRetiredTracks();
+    sendHeldCommands();
+}
+
+void DJAudioPlayer::sendCommand(Command::Type type, double value, double endValue)
+{
+    Command command;
+    command.type = type;
+    command.value = value;
+    command.endValue = endValue;
+    sendCommand(command);
+}
+
+void DJAudioPlayer::sendCommand(const Command& command)
+{
+    // A load sends the replaced track back to be freed, held commands need sending later
+    const bool needsService = command.track != nullptr || !heldCommands.empty() || commands.isFull();
+    if (needsService && !isTimerRunning())
+        startTimer(serviceIntervalMs);
+
+    // Commands never overtake held ones, so the audio thread sees them in the order they were sent
+    if (sendHeldCommands())
+    {
+        heldCommands.push_back(command);
+        if (sendHeldCommands())
+            return;
+    }
+    else
+    {
+        // Only the latest of two waiting seeks or loads would have any effect
+        auto& last = heldCommands.back();
+        const bool isSeek = command.type == Command::Type::seek || command.type == Command::Type::seekRelative;
+        const bool lastIsSeek = last.type == Command::Type::seek || last.type == Command::Type::seekRelative;
+
+        if ((isSeek && lastIsSeek) || (command.type == Command::Type::load && last.type == Command::Type::load))
+        {
+            delete last.track;
+            last = command;
+        }
+        else
+        {
+            heldCommands.push_back(command);
+        }
+    }
+
+    DBG("DJAudioPlayer::sendCommand command queue is full, " + String((int)heldCommands.size()) + " held back");
 }
 
-void DJAudioPlayer::loadURL(URL audioURL)
+bool DJAudioPlayer::sendHeldCommands()
 {
-    // Try to create a reader for the given audio file
-    auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
-    if (reader != nullptr)
+    while (!heldCommands.empty())
     {
-        // Set up a new source for the audio file
-        unique_ptr<AudioFormatReaderSource> newSource(new AudioFormatReaderSource(reader, true));
+        // The device may have changed while the track was loading or held back,
+        // so it is prepared again here and the audio thread never has to
+        Command& command = heldCommands.front();
+        if (command.track != nullptr && sampleRate > 0.0 && !command.track->isPreparedFor(blockSize, sampleRate))
+            command.track->prepareToPlay(blockSize, sampleRate);
 
-        // Pass it to the transport source, which handles playback
-        transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
+        if (!commands.push(command))
+            return false;
+
+        heldCommands.pop_front();
+    }
 
-        // Store the source and take ownership of it
-        readerSource.reset(newSource.release());
+    return true;
+}
 
-        // Reset EQ to neutral when loading a new track
-        resetEQ();
+void DJAudioPlayer::collectRetiredTracks()
+{
+    DeckTrack* retired = nullptr;
+    while (retiredTracks.pop(retired))
+    {
+        // Keep the deck's underrun count across tracks
+        underrunsFromPreviousTracks += retired->getUnderrunCount();
+        delete retired;
     }
 }
 
-void DJAudioPlayer::setGain(double gain)
+void DJAudioPlayer::setGain(double _gain)
 {
     // Validate input range
-    if (gain < 0 || gain > 1)
+    if (_gain < 0 || _gain > 1)
     {
         DBG("DJAudioPlayer::setGain gain should be between 0 and 1");
     }
     else {
-        transportSource.setGain(gain);
+        gain = (float)_gain;
     }
 }
 
 void DJAudioPlayer::setSpeed(double ratio)
 {
     // Validate input range
-    if (ratio < 0.0 || ratio > 10.0)
+    if (ratio < 0.0 || ratio > DeckResampler::maxRatio)
     {
-        DBG("DJAudioPlayer::setSpeed ratio value should be between 0 and 100");
+        DBG("DJAudioPlayer::setSpeed ratio value should be between 0 and " + String(DeckResampler::maxRatio));
     }
     else {
-        // Apply speed change using the resampler
-        resampleSource.setResamplingRatio(ratio);
+        // Picked up by the resampler on the next block
+        speed = ratio;
     }
 }
 
 void DJAudioPlayer::setPosition(double posInSecs)
 {
-    // Set playback position in seconds
-    transportSource.setPosition(posInSecs);
+    // Set playback position in seconds, applied on the next block
+    sendCommand(Command::Type::seek, jmax(0.0, posInSecs));
 }
 
 void DJAudioPlayer::setPositionRelative(double pos)
@@ -150,52 +450,170 @@ void DJAudioPlayer::setPositionRelative(double pos)
         DBG("DJAudioPlayer::setPositionRelative relative position value should be between 0 and 1");
     }
     else {
-        // Convert relative position (0-1) to actual time in seconds
-        double posInSeconds = transportSource.getLengthInSeconds() * pos;
-        setPosition(posInSeconds);
+        // Converted to samples on the audio thread, in case a new track is queued
+        sendCommand(Command::Type::seekRelative, pos);
     }
 }
 
+void DJAudioPlayer::setLooping(bool shouldLoop)
+{
+    sendCommand(Command::Type::looping, shouldLoop ? 1.0 : 0.0);
+}
+
+void DJAudioPlayer::setLoopPoints(double inSeconds, double outSeconds)
+{
+    sendCommand(Command::Type::loopPoints, inSeconds, outSeconds);
+}
+
+void DJAudioPlayer::clearLoopPoints()
+{
+    sendCommand(Command::Type::loopPoints);
+}
+
+int DJAudioPlayer::getBlockSize() const
+{
+    return blockSize;
+}
+
+double DJAudioPlayer::getSampleRate() const
+{
+    return sampleRate;
+}
+
 void DJAudioPlayer::start()
 {
-    transportSource.start();
+    // Ignored by the audio thread if no track is loaded by then
+    sendCommand(Command::Type::play);
 }
 
 void DJAudioPlayer::stop()
 {
-    transportSource.stop();
+    sendCommand(Command::Type::stop);
 }
 
 double DJAudioPlayer::getPositionRelative()
 {
-    return transportSource.getCurrentPosition() / transportSource.getLengthInSeconds();
+    const int64 length = trackLength;
+    return length > 0 ? (double)playheadSample / (double)length : 0.0;
 }
 
 bool DJAudioPlayer::playing()
 {
-    return transportSource.isPlaying();
+    return playingState;
 }
 
 // Limit bands to reasonable range and store them
 void DJAudioPlayer::setHighGain(double gain)
 {
-    highGain = jlimit(0.0, 2.0, gain);
+    highGain = (float)jlimit(0.0, 2.0, gain);
 }
 
 void DJAudioPlayer::setMidGain(double gain)
 {
-    midGain = jlimit(0.0, 2.0, gain);
+    midGain = (float)jlimit(0.0, 2.0, gain);
 }
 
 void DJAudioPlayer::setLowGain(double gain)
 {
-    lowGain = jlimit(0.0, 2.0, gain);
+    lowGain = (float)jlimit(0.0, 2.0, gain);
 }
 
 void DJAudioPlayer::resetEQ()
 {
     // Reset all EQ bands to neutral position (no boost/cut)
-    lowGain = 1.0;
-    midGain = 1.0;
-    highGain = 1.0;
-}
\ No newline at end of file
+    lowGain = 1.0f;
+    midGain = 1.0f;
+    highGain = 1.0f;
+}
+
+void DJAudioPlayer::setEQKernel(BandSplitEQ::Kernel kernel)
+{
+    eq.setKernel(kernel);
+}
+
+BandSplitEQ::Kernel DJAudioPlayer::getEQKernel() const
+{
+    return eq.getKernel();
+}
+
+double DJAudioPlayer::getEQProcessMicroseconds() const
+{
+    return eq.getAverageProcessMicroseconds();
+}
+
+void DJAudioPlayer::setKeyLock(bool shouldLockKey)
+{
+    keyLock = shouldLockKey;
+}
+
+bool DJAudioPlayer::isKeyLockEnabled() const
+{
+    return keyLock;
+}
+
+void DJAudioPlayer::setTimeStretchQuality(TimeStretchSource::Quality quality)
+{
+    timeStretch.setQuality(quality);
+}
+
+TimeStretchSource::Quality DJAudioPlayer::getTimeStretchQuality() const
+{
+    return timeStretch.getQuality();
+}
+
+double DJAudioPlayer::getTimeStretchMicroseconds() const
+{
+    return timeStretch.getAverageProcessMicroseconds();
+}
+
+void DJAudioPlayer::setResamplerMode(DeckResampler::Mode mode)
+{
+    resampleSource.setMode(mode);
+}
+
+DeckResampler::Mode DJAudioPlayer::getResamplerMode() const
+{
+    return resampleSource.getMode();
+}
+
+double DJAudioPlayer::getResamplerNanosecondsPerSample() const
+{
+    return resampleSource.getAverageNanosecondsPerSample();
+}
+
+double DJAudioPlayer::getCpuLoad() const
+{
+    return cpuLoad;
+}
+
+void DJAudioPlayer::setGainRampSeconds(double seconds)
+{
+    eq.setRampLengthSeconds(seconds);
+}
+
+double DJAudioPlayer::getGainRampSeconds() const
+{
+    return eq.getRampLengthSeconds();
+}
+
+void DJAudioPlayer::setReadAheadSamples(int numSamples)
+{
+    readAheadSamples = jmax(0, numSamples);
+}
+
+int DJAudioPlayer::getReadAheadSamples() const
+{
+    return readAheadSamples;
+}
+
+int DJAudioPlayer::getUnderrunCount() const
+{
+    auto* track = activeTrack.load();
+    return underrunsFromPreviousTracks + (track != nullptr ? track->getUnderrunCount() : 0);
+}
+
+DeckTrack::PlaybackMode DJAudioPlayer::getPlaybackMode() const
+{
+    auto* track = activeTrack.load();
+    return track != nullptr ? track->getPlaybackMode() : DeckTrack::PlaybackMode::none;
+}
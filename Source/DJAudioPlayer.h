@@ -1,17 +1,31 @@
 #pragma once
 using namespace std;
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "BandSplitEQ.h"
+#include "DeckResampler.h"
+#include "DeckTrack.h"
+#include "SpscQueue.h"
+#include "TimeStretchSource.h"
+#include <atomic>
+#include <deque>
 
 /**
  * Handles audio playback with DJ-style controls including
  * speed adjustment, volume control, and 3-band EQ.
  * Inherits from AudioSource to integrate with JUCE's audio pipeline.
+ * Tracks are built off the audio thread (see TrackLoader).
+ * The message thread never touches playback state directly: continuous
+ * controls (gain, speed, EQ) are atomics read once per block, and discrete
+ * actions (load, play, stop, seek) go through a lock-free command queue that
+ * the audio thread drains at the start of each block. Should that queue ever be
+ * full (the device stopped, say), commands are held back in order and sent later,
+ * so none is ever lost.
  */
-class DJAudioPlayer : public AudioSource {
+class DJAudioPlayer : public AudioSource,
+    private Timer {
 
 public:
-    // Constructor takes a reference to format manager for loading different audio formats
-    DJAudioPlayer(AudioFormatManager& _formatManager);
+    DJAudioPlayer();
     ~DJAudioPlayer() override;
 
     // ==== AudioSource interface methods ====
@@ -20,12 +34,27 @@ public:
     void releaseResources() override;
 
     // ==== Track loading and playback control ====
-    void loadURL(URL audioURL);
+    // Hands a prepared track to the audio thread, which picks it up on its next block.
+    // A load still held back is replaced, its track is freed here.
+    void loadTrack(unique_ptr<DeckTrack> track);
     void setGain(double gain);
     void setSpeed(double ratio);
+    // Seeks are applied on the next block, relative ones against the track playing by then
     void setPosition(double posInSecs);
     void setPositionRelative(double pos);
 
+    // ==== Looping ====
+    // Loops are handled on the audio thread, wrapping inside the block with a short crossfade.
+    // With looping off the deck stops and rewinds at the end of the track.
+    void setLooping(bool shouldLoop);
+    // Loop in/out points in seconds, the whole track is looped while none are set
+    void setLoopPoints(double inSeconds, double outSeconds);
+    void clearLoopPoints();
+
+    // Current playback settings, used to prepare tracks before they are loaded
+    int getBlockSize() const;
+    double getSampleRate() const;
+
     // ==== EQ control functions ====
     // Adjust band gains (1.0 = neutral, <1.0 = cut, >1.0 = boost)
     void setHighGain(double gain);
@@ -33,6 +62,7 @@ public:
     void setLowGain(double gain);
 
     // ==== Playback state control ====
+    // Queued for the next block, playing() reports the state the audio thread has applied
     void start();
     void stop();
     double getPositionRelative();
@@ -40,28 +70,140 @@ public:
     // Reset all EQ bands to neutral (1.0)
     void resetEQ();
 
+    // ==== EQ kernel selection and profiling ====
+    // Switch between the scalar and SIMD EQ kernels, e.g. to compare their cost per deck
+    void setEQKernel(BandSplitEQ::Kernel kernel);
+    BandSplitEQ::Kernel getEQKernel() const;
+    double getEQProcessMicroseconds() const;
+
+    // ==== Key lock ====
+    // Tempo changes keep the original pitch (WSOLA time-stretch instead of resampling)
+    void setKeyLock(bool shouldLockKey);
+    bool isKeyLockEnabled() const;
+    void setTimeStretchQuality(TimeStretchSource::Quality quality);
+    TimeStretchSource::Quality getTimeStretchQuality() const;
+    double getTimeStretchMicroseconds() const;
+
+    // ==== Resampler ====
+    // Interpolation used for speed changes and sample rate conversion (default sinc)
+    void setResamplerMode(DeckResampler::Mode mode);
+    DeckResampler::Mode getResamplerMode() const;
+    double getResamplerNanosecondsPerSample() const;
+
+    // Fraction of real time spent rendering this deck (0.01 = 1% of one core)
+    double getCpuLoad() const;
+
+    // ==== Parameter smoothing ====
+    // Ramp time for gain and EQ changes (default 20 ms)
+    void setGainRampSeconds(double seconds);
+    double getGainRampSeconds() const;
+
+    // ==== Disk streaming ====
+    // Read-ahead for tracks loaded on this deck from now on (0 = service default)
+    void setReadAheadSamples(int numSamples);
+    int getReadAheadSamples() const;
+    // Blocks played as silence because the disk or codec could not keep up
+    int getUnderrunCount() const;
+    // How the playing track is read (streamed, cached or memory-mapped)
+    DeckTrack::PlaybackMode getPlaybackMode() const;
+
+    // Frees tracks the audio thread has let go of and sends held-back commands (message thread).
+    // A timer does this in the app; code driving the deck without a message loop, like the
+    // offline renderer, calls it every block.
+    void serviceQueues();
+
 private:
-    // Reference to the format manager for loading audio files
-    AudioFormatManager& formatManager;
+    // Feeds the resampler from the current track (audio thread only)
+    class TrackReader : public AudioSource {
+    public:
+        TrackReader(DJAudioPlayer& _owner) : owner(_owner) {}
+        void prepareToPlay(int, double) override {}
+        void releaseResources() override {}
+        void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override { owner.readTrack(bufferToFill); }
+
+    private:
+        DJAudioPlayer& owner;
+    };
+
+    // Discrete actions sent from the message thread to the audio thread
+    struct Command {
+        enum class Type { load, play, stop, seek, seekRelative, looping, loopPoints };
+        Type type = Type::stop;
+        double value = 0.0;           // Seconds for seek and loop in, 0..1 for seekRelative, 0/1 for looping
+        double endValue = 0.0;        // Loop out in seconds (loopPoints only)
+        DeckTrack* track = nullptr;   // Owned by the queue until applied (load only)
+    };
+
+    // Audio thread helpers
+    void applyCommands();
+    // False if the replaced track has no room on its way back, nothing changes then
+    bool adoptTrack(DeckTrack* next);
+    void readTrack(const AudioSourceChannelInfo& bufferToFill);
+    void wrapLoop(int64 loopStartSample, int64 loopEndSample);
+    void applySeamFade(AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // Message thread side of the queues
+    void sendCommand(Command::Type type, double value = 0.0, double endValue = 0.0);
+    void sendCommand(const Command& command);
+    // Pushes held-back commands until the queue is full again, true once none are left
+    bool sendHeldCommands();
+    void collectRetiredTracks();
+
+    // Runs only while something is on its way through the queues
+    void timerCallback() override;
+    static constexpr int serviceIntervalMs = 250;
+
+    // Message thread -> audio thread, and the replaced tracks coming back to be freed
+    SpscQueue<Command, 64> commands;
+    SpscQueue<DeckTrack*, 8> retiredTracks;
+    std::atomic<DeckTrack*> activeTrack{ nullptr };  // Audio thread's current track, readable from the message thread
+    DeckTrack* currentTrack = nullptr;  // Audio thread only
+    std::deque<Command> heldCommands;  // Message thread only, waiting for room in the queue
 
     // Audio source chain for playback
-    unique_ptr<AudioFormatReaderSource> readerSource;
-    AudioTransportSource transportSource;  // Handles playback, seeking, etc.
-    ResamplingAudioSource resampleSource{ &transportSource, false, 2 };  // For speed control
+    TrackReader trackReader{ *this };
+    DeckResampler resampleSource{ &trackReader, 2 };  // For speed control
+    TimeStretchSource timeStretch{ &resampleSource, 2 };  // Only in the chain with key lock on
 
-    // EQ filters for 3-band equalization
-    IIRFilter lowFilter;
-    IIRFilter midFilter;
-    IIRFilter highFilter;
+    // 3-band equalization and smoothed output gain, preallocated in prepareToPlay
+    BandSplitEQ eq;
 
     // Audio parameters
-    double sampleRate = 44100.0;  // Default sample rate
-    bool filtersInitialized = false;
+    std::atomic<double> sampleRate{ 0.0 };  // 0 until prepareToPlay
+    std::atomic<int> blockSize{ 0 };
+
+    // Continuous controls, written by the message thread and read once per block
+    std::atomic<double> speed{ 1.0 };
+    std::atomic<float> gain{ 1.0f };
+    std::atomic<float> lowGain{ 1.0f };
+    std::atomic<float> midGain{ 1.0f };
+    std::atomic<float> highGain{ 1.0f };
+    std::atomic<bool> keyLock{ false };
+
+    // Audio thread only
+    bool isPlaying = false;
+    double appliedRatio = 0.0;
+    bool appliedKeyLock = false;
+
+    // Loop state in track samples (audio thread only), loopEnd <= loopStart means the whole track
+    bool looping = false;
+    int64 loopStart = 0;
+    int64 loopEnd = 0;
+
+    // At a loop wrap, the audio that would have followed the loop end is faded out
+    // under the start of the loop. The tail buffer is allocated in prepareToPlay.
+    static constexpr double seamFadeSeconds = 0.005;
+    static constexpr int maxSeamSamples = 4096;
+    AudioBuffer<float> seamTail;
+    int seamLength = 0;
+    int seamPosition = 0;
 
-    double lowGain = 1.0;
-    double midGain = 1.0;
-    double highGain = 1.0;
+    // Published by the audio thread for the UI
+    std::atomic<bool> playingState{ false };
+    std::atomic<int64> playheadSample{ 0 };
+    std::atomic<int64> trackLength{ 0 };
+    std::atomic<double> cpuLoad{ 0.0 };
 
-    // Helper method to initialize filters with current sample rate
-    void updateFilters();
-};
\ No newline at end of file
+    int readAheadSamples = 0;
+    int underrunsFromPreviousTracks = 0;
+};
@@ -1,8 +1,7 @@
 #include "DeckGUI.h"
 #include "JuceHeader.h"
-DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse,
-        AudioThumbnailCache& thumbCacheToUse)
-    : player(_player), waveformDisplay(formatManagerToUse, thumbCacheToUse)
+DeckGUI::DeckGUI(DJAudioPlayer* _player, TrackLoader& trackLoaderToUse)
+    : player(_player), trackLoader(trackLoaderToUse)
 {
 
     // ===== COMPONENT INITIALIZATION AND VISIBILITY =====
@@ -12,6 +11,12 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse,
     deckLabel.setJustificationType(Justification::centred);
     deckLabel.setColour(Label::textColourId, Colour(0xFFf5a623));
 
+    // Small label under the deck name showing how the loaded track is read
+    addAndMakeVisible(playbackModeLabel);
+    playbackModeLabel.setFont(Font(12.0f));
+    playbackModeLabel.setJustificationType(Justification::centred);
+    playbackModeLabel.setColour(Label::textColourId, Colour(0xFFaaaaaa));
+
     // Add all components to the deck's visual hierarchy
     addAndMakeVisible(waveformDisplay);  // Waveform visualization
     addAndMakeVisible(playPauseButton);  // Transport controls
@@ -27,9 +32,11 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse,
     addAndMakeVisible(midEQSlider);
     addAndMakeVisible(lowEQSlider);
     addAndMakeVisible(eqToggleButton);
+    addAndMakeVisible(keyLockButton);
     addAndMakeVisible(highLabel);        // EQ labels
     addAndMakeVisible(midLabel);
     addAndMakeVisible(lowLabel);
+    addChildComponent(loadProgressBar);  // Only shown while a track is loading
 
     // ===== TRANSPORT CONTROLS SETUP =====
     // Set up the play/pause button
@@ -46,6 +53,15 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse,
     loopButton.addListener(this);
     loopButton.setClickingTogglesState(true);
 
+    // Key lock keeps the pitch when the tempo changes
+    keyLockButton.setLookAndFeel(&djDeckLookAndFeel);
+    keyLockButton.addListener(this);
+    keyLockButton.setClickingTogglesState(true);
+
+    // Style the load progress bar to match the deck
+    loadProgressBar.setColour(ProgressBar::backgroundColourId, Colour(0xFF2d3035));
+    loadProgressBar.setColour(ProgressBar::foregroundColourId, Colour(0xFFf5a623));
+
     // ===== VOLUME AND SPEED CONTROLS =====
     // Configure rotary volume control
     volSlider.setSliderStyle(Slider::Rotary);
@@ -139,41 +155,24 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse,
     midLabel.setColour(Label::textColourId, Colour(0xFFaaaaaa));
     lowLabel.setColour(Label::textColourId, Colour(0xFFaaaaaa));
 
-    // ===== INITIALIZE TIMER =====
-    // Start timer to update waveform position and vinyl rotation (~60fps)
-    startTimer(16);
+    // ===== FRAME UPDATES =====
+    // Waveform position and vinyl rotation follow the display's frames while the deck moves
+    frameScheduler->addClient(this, *this);
 }
 DeckGUI::~DeckGUI() {
-    stopTimer();
+    frameScheduler->removeClient(this);
+    // Make sure a load finishing later doesn't call back into this deck
+    cancelLoad();
 }
 
 void DeckGUI::paint(Graphics& g) {
-    //Gradient background for more realistic DJ deck look
-    ColourGradient gradient(
-        Colour(0xFF202020), 0, 0,
-        Colour(0xFF101010), 0, getHeight(),
-        false
-    );
-    g.setGradientFill(gradient);
-    g.fillAll();
-
-    // Add overlay pattern
-    g.setOpacity(0.05f);
-    for (int y = 0; y < getHeight(); y += 4) {
-        g.setColour(Colours::white.withAlpha(0.1f));
-        g.drawHorizontalLine(y, 0, getWidth());
-    }
-
-    // Tint for distinguishing decks
-    if (deckId == 0) {
-        // Left deck - very slight blue tint
-        g.setColour(Colours::blue.withAlpha(0.02f));
-    }
-    else {
-        // Right deck - very slight red tint
-        g.setColour(Colours::red.withAlpha(0.02f));
-    }
-    g.fillAll();
+    // Gradient background for more realistic DJ deck look, with a tint for distinguishing decks:
+    // very slight blue on the left side of the crossfader, very slight red on the right
+    BackgroundLayer::Style style;
+    style.top = Colour(0xFF202020);
+    style.bottom = Colour(0xFF101010);
+    style.tint = (deckId % 2 == 0 ? Colours::blue : Colours::red).withAlpha(0.02f);
+    backgroundLayer.draw(g, getWidth(), getHeight(), style);
 }
 
 void DeckGUI::resized()
@@ -183,6 +182,8 @@ void DeckGUI::resized()
 
     // Position waveform
     waveformDisplay.setBounds(area.removeFromTop(120));
+    auto progressArea = waveformDisplay.getBounds();
+    loadProgressBar.setBounds(progressArea.removeFromBottom(18).reduced(60, 2));
     area.removeFromTop(10); // Spacing
 
     // Reserve button area
@@ -212,6 +213,7 @@ void DeckGUI::resized()
     int labelHeight = 30;
     deckLabel.setBounds(originalLeftColumn.getX(), originalLeftColumn.getY() + 10,
                        leftWidth, labelHeight);
+    playbackModeLabel.setBounds(deckLabel.getX(), deckLabel.getBottom(), leftWidth, 20);
 
     // Size for controls
     int controlHeight = jmin(95, leftColumn.getHeight() / 3);
@@ -264,7 +266,7 @@ void DeckGUI::resized()
     );
 
     int buttonGap = 3;
-    int buttonWidth = (adjustedButtonArea.getWidth() - (buttonGap * 3)) / 4;
+    int buttonWidth = (adjustedButtonArea.getWidth() - (buttonGap * 4)) / 5;
     int xPos = adjustedButtonArea.getX();
 
     // Position buttons in sequence
@@ -278,6 +280,9 @@ void DeckGUI::resized()
     xPos += buttonWidth + buttonGap;
 
     eqToggleButton.setBounds(xPos, adjustedButtonArea.getY(), buttonWidth, adjustedButtonArea.getHeight());
+    xPos += buttonWidth + buttonGap;
+
+    keyLockButton.setBounds(xPos, adjustedButtonArea.getY(), buttonWidth, adjustedButtonArea.getHeight());
 }
 
 
@@ -285,27 +290,34 @@ void DeckGUI::resized()
 void DeckGUI::buttonClicked(Button* button)
 {
     if (button == &playPauseButton) {
-        if (player->playing()) {
-            player->stop();
+        // The player applies this on its next block, so the button shows what was asked for
+        const bool shouldPlay = !player->playing();
+        if (shouldPlay) {
+            player->start();
         }
         else {
-            player->start();
+            player->stop();
         }
-        button->setToggleState(player->playing(), dontSendNotification);
-
-        // Force vinyl slider repaint when play state changes
-        vinylSlider.repaint();
+        button->setToggleState(shouldPlay, dontSendNotification);
     }
 
     if (button == &loadButton)
     {
+        // While a track is loading the button cancels it
+        if (loadTicket != nullptr)
+        {
+            cancelLoad();
+            return;
+        }
+
         // Open file chooser to load a track
         auto fileChooserFlags = FileBrowserComponent::canSelectFiles;
 
         fChooser.launchAsync(fileChooserFlags, [this](const FileChooser& chooser)
         {
-            player->loadURL(URL{ chooser.getResult() });
-            waveformDisplay.loadURL(URL{ chooser.getResult() });
+            auto result = chooser.getResult();
+            if (result.existsAsFile())
+                loadTrack(URL{ result });
         });
     }
 
@@ -337,10 +349,17 @@ void DeckGUI::buttonClicked(Button* button)
     }
     if (button == &loopButton)
     {
+        // The player wraps the loop itself, sample-accurately on the audio thread
         isLooping = loopButton.getToggleState();
+        player->setLooping(isLooping);
+    }
+    if (button == &keyLockButton)
+    {
+        player->setKeyLock(keyLockButton.getToggleState());
     }
 
-
+    // Any of these may start the deck moving
+    frameScheduler->wake();
 }
 
 void DeckGUI::sliderValueChanged(Slider* slider) {
@@ -370,6 +389,9 @@ void DeckGUI::sliderValueChanged(Slider* slider) {
     else if (slider == &lowEQSlider) {
         player->setLowGain(slider->getValue());
     }
+
+    // Seeking moves the playhead, even on a stopped deck
+    frameScheduler->wake();
 }
 
 void DeckGUI::sliderDragStarted(Slider* slider) {
@@ -398,15 +420,18 @@ void DeckGUI::filesDropped(const StringArray& files, int x, int y) {
         for (String filename : files)
         {
             URL fileURL = URL{ File{filename} };
-            player->loadURL(fileURL);
-            waveformDisplay.loadURL(fileURL);
+            loadTrack(fileURL);
             return;
         }
     }
 }
 
 
-void DeckGUI::timerCallback() {
+bool DeckGUI::updateFrame() {
+    // The progress bar repaints itself from loadProgress
+    if (loadTicket != nullptr)
+        loadProgress = loadTicket->getProgress();
+
     double currentPosition = player->getPositionRelative();
 
     // Ensure currentPosition is valid (between 0 and 1), fallback to 0 if NaN
@@ -415,7 +440,7 @@ void DeckGUI::timerCallback() {
     else
         currentPosition = jlimit(0.0, 1.0, currentPosition);
 
-    // Update UI components
+    // Update UI components, each repaints only if what it shows has changed
     waveformDisplay.setPositionRelative(currentPosition);
 
     // Only update position slider if not being dragged
@@ -424,42 +449,100 @@ void DeckGUI::timerCallback() {
         vinylSlider.setValue(currentPosition, dontSendNotification);
     }
 
-    // Handle track end
-    if (currentPosition >= 0.999)
+    // The player stops by itself at the end of a track, follow it when its state changes
+    const uint32 now = Time::getMillisecondCounter();
+    const bool playerPlaying = player->playing();
+    if (playerPlaying != wasPlayerPlaying)
     {
-        if (isLooping)
+        playPauseButton.setToggleState(playerPlaying, dontSendNotification);
+        wasPlayerPlaying = playerPlaying;
+        nextStatusRefresh = now;
+    }
+
+    // The status text only needs refreshing a couple of times per second
+    if ((int32)(now - nextStatusRefresh) >= 0)
+    {
+        updateStatusLabel();
+        nextStatusRefresh = now + 500;
+    }
+
+    return playerPlaying || loadTicket != nullptr || isVinylBeingDragged;
+}
+
+void DeckGUI::updateStatusLabel()
+{
+    const auto mode = player->getPlaybackMode();
+    if (mode == DeckTrack::PlaybackMode::none)
+    {
+        playbackModeLabel.setText("", dontSendNotification);
+        return;
+    }
+
+    playbackModeLabel.setText(String(DeckTrack::getPlaybackModeName(mode))
+        + "  CPU " + String(player->getCpuLoad() * 100.0, 1) + "%", dontSendNotification);
+}
+
+void DeckGUI::setDeckId(int id)
+{
+    deckId = id;
+
+    // Decks are lettered A, B, C... in the order they were added
+    deckLabel.setText("DECK " + String::charToString((juce_wchar)('A' + deckId)), dontSendNotification);
+}
+
+void DeckGUI::loadTrack(const URL& audioURL)
+{
+    // Only one load per deck, a new one replaces whatever is still running
+    cancelLoad();
+
+    loadProgress = 0.0;
+    loadProgressBar.setVisible(true);
+    loadButton.setButtonText("CANCEL");
+    frameScheduler->wake();
+
+    loadTicket = trackLoader.loadForDeck(audioURL,
+        player->getReadAheadSamples(),
+        player->getBlockSize(),
+        player->getSampleRate(),
+        [this, audioURL](unique_ptr<DeckTrack> track, unique_ptr<AudioFormatReader> thumbnailReader, const String& error)
         {
-            player->setPositionRelative(0.0);
-            // If not already playing, start playback
-            if (!player->playing())
+            finishLoad();
+
+            if (track == nullptr)
             {
-                player->start();
-                playPauseButton.setToggleState(true, dontSendNotification);
+                DBG("DeckGUI::loadTrack " + error);
+                return;
             }
-        }
-        else
-        {
-            // Stop at end if not looping
-            player->setPositionRelative(0.0);
-            player->stop();
+
+            // The new track starts stopped
+            player->loadTrack(std::move(track));
+            waveformDisplay.loadReader(thumbnailReader.release(), audioURL);
             playPauseButton.setToggleState(false, dontSendNotification);
-        }
-    }
+            frameScheduler->wake();
+        });
+}
 
-    // Make sure the slider is visible and force repaint
-    vinylSlider.repaint();
+void DeckGUI::cancelLoad()
+{
+    if (loadTicket != nullptr)
+        loadTicket->cancel();
 
+    finishLoad();
 }
 
-void DeckGUI::setDeckId(int id)
+double DeckGUI::getVinylPaintMicroseconds() const
 {
-    deckId = id;
+    return djDeckLookAndFeel.getAverageVinylPaintMicroseconds();
+}
 
-    // Set appropriate deck label text
-    if (deckId == 0) {
-        deckLabel.setText("DECK A", dontSendNotification);
-    }
-    else {
-        deckLabel.setText("DECK B", dontSendNotification);
-    }
+const BackgroundLayer& DeckGUI::getBackgroundLayer() const
+{
+    return backgroundLayer;
+}
+
+void DeckGUI::finishLoad()
+{
+    loadTicket = nullptr;
+    loadProgressBar.setVisible(false);
+    loadButton.setButtonText("LOAD");
 }
\ No newline at end of file
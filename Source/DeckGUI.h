@@ -4,6 +4,9 @@
 #include "DJAudioPlayer.h"
 #include "WaveformDisplay.h"
 #include "DeckGUILookAndFeel.h"
+#include "TrackLoader.h"
+#include "FrameScheduler.h"
+#include "BackgroundLayer.h"
 
 /*
 * DeckGUI class represents a single deck in theour DJ application.
@@ -15,17 +18,15 @@ class DeckGUI : public Component,
     public Button::Listener,
     public Slider::Listener,
     public FileDragAndDropTarget,
-    public Timer
+    public FrameScheduler::Client
 {
 public:
     /* Constructor takes pointers to:
        * - DJAudioPlayer: to control audio playback
-       * - AudioFormatManager: to handle various audio file formats
-       * - AudioThumbnailCache: for waveform generation
+       * - TrackLoader: to open and decode tracks off the message thread
        */
     DeckGUI(DJAudioPlayer* player,
-        AudioFormatManager& formatManagerToUse,
-        AudioThumbnailCache& thumbCacheToUse);
+        TrackLoader& trackLoaderToUse);
     ~DeckGUI() override;
 
     void paint(Graphics& g) override;
@@ -40,21 +41,36 @@ public:
     // Tracks if the vinyl disc is being dragged
     bool isVinylBeingDragged = false;
     bool isLooping = false;
-    void timerCallback() override;
+    bool wasPlayerPlaying = false;
+    // Follows the player once per frame, asks for more frames while the deck moves
+    bool updateFrame() override;
 
-    // Sets the deck ID (0 for Deck A, 1 for Deck B), needed mainly for styling
+    // Sets the deck ID (0 for Deck A, 1 for Deck B...), needed mainly for styling
     void setDeckId(int id);
+    int getDeckId() const { return deckId; }
+
+    // Loads a track in the background, showing progress until it is ready to play
+    void loadTrack(const URL& audioURL);
+    // Stops a running load, the deck keeps its current track
+    void cancelLoad();
+
+    // Average time spent drawing the spinning vinyl per frame
+    double getVinylPaintMicroseconds() const;
+    // Cached background, for its paint timings
+    const BackgroundLayer& getBackgroundLayer() const;
 
     // Made public so playlist can access it when loading tracks
     WaveformDisplay waveformDisplay;
 private:
     DeckGUILookAndFeel djDeckLookAndFeel;
+    BackgroundLayer backgroundLayer;
 
     // Transport controls
     TextButton playPauseButton{ "PLAY" };
     TextButton loadButton{ "LOAD" };
     TextButton loopButton{ "LOOP" };
     TextButton eqToggleButton{ "EQ" };
+    TextButton keyLockButton{ "KEY" };
     FileChooser fChooser{ "Select a file..." };
     int deckId = 0;
     Slider volSlider;
@@ -79,7 +95,19 @@ private:
 
 
     Label deckLabel{ "deckLabel", "" };
+    Label playbackModeLabel{ "playbackModeLabel", "" };  // STREAM, RAM or MAPPED, plus the deck's CPU load
+    uint32 nextStatusRefresh = 0;  // Millisecond counter
+    void updateStatusLabel();
     DJAudioPlayer* player;
+    SharedResourcePointer<FrameScheduler> frameScheduler;
+
+    // Background loading, the LOAD button turns into CANCEL while a load runs
+    TrackLoader& trackLoader;
+    TrackLoader::TicketPtr loadTicket;
+    double loadProgress = 0.0;
+    ProgressBar loadProgressBar{ loadProgress };
+    void finishLoad();
+
     void sliderDragStarted(Slider* slider) override;
     void sliderDragEnded(Slider* slider) override;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckGUI)
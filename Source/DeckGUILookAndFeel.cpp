@@ -21,6 +21,8 @@ void DeckGUILookAndFeel::drawRotatoryVinyl(Graphics& g,
     if (width <= 0 || height <= 0)
         return;
 
+    const int64 paintStart = Time::getHighResolutionTicks();
+
     // Ensure position is valid (even when no track is loaded)
     if (std::isnan(sliderPos))
         sliderPos = 0.0f;
@@ -31,14 +33,63 @@ void DeckGUILookAndFeel::drawRotatoryVinyl(Graphics& g,
     auto radius = (float)jmin(width / 2, height / 2) - 4.0f;
     auto centreX = (float)x + (float)width * 0.5f;
     auto centreY = (float)y + (float)height * 0.5f;
-    auto rx = centreX - radius;
-    auto ry = centreY - radius;
-    auto rw = radius * 2.0f;
 
     // Calculate rotation angle - Start from top (North) position
     const float startingAngle = MathConstants<float>::pi;
     auto angle = startingAngle + sliderPos * MathConstants<float>::twoPi;
 
+    // Everything but the pointer looks the same at any angle, so it comes from the sprite,
+    // drawn at the display's pixel scale to stay sharp
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (width != platterWidth || height != platterHeight || scale != platterScale)
+        renderPlatter(width, height, scale);
+
+    if (scale == 1.0f)
+        g.drawImageAt(platterImage, x, y);
+    else
+        g.drawImageTransformed(platterImage, AffineTransform::scale(1.0f / scale).translated((float)x, (float)y));
+
+    float labelRadius = radius * 0.35f;
+
+    Path p;
+    auto pointerThickness = 3.0f;
+    float outerPointerStart = -radius;
+    float outerPointerLength = radius * 0.65f; // Stops before the label
+
+    p.addRectangle(-pointerThickness * 0.5f, outerPointerStart,
+                  pointerThickness, outerPointerLength);
+
+    p.addRectangle(-pointerThickness * 0.5f, labelRadius,
+                  pointerThickness, outerPointerLength);
+
+    // Rotate line to current playback position
+    p.applyTransform(AffineTransform::rotation(angle).translated(centreX, centreY));
+
+    // Draw white position indicator
+    g.setColour(Colours::white);
+    g.fillPath(p);
+
+    const double microseconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - paintStart) * 1.0e6;
+    averageVinylPaintMicroseconds += 0.05 * (microseconds - averageVinylPaintMicroseconds);
+}
+
+void DeckGUILookAndFeel::renderPlatter(int width, int height, float scale)
+{
+    platterWidth = width;
+    platterHeight = height;
+    platterScale = scale;
+    platterImage = Image(Image::ARGB, jmax(1, roundToInt(width * scale)), jmax(1, roundToInt(height * scale)), true);
+
+    Graphics g(platterImage);
+    g.addTransform(AffineTransform::scale(scale));
+
+    auto radius = (float)jmin(width / 2, height / 2) - 4.0f;
+    auto centreX = (float)width * 0.5f;
+    auto centreY = (float)height * 0.5f;
+    auto rx = centreX - radius;
+    auto ry = centreY - radius;
+    auto rw = radius * 2.0f;
+
     // Draw vinyl record base (black disc)
     g.setColour(Colours::black);
     g.fillEllipse(rx, ry, rw, rw);
@@ -47,10 +98,7 @@ void DeckGUILookAndFeel::drawRotatoryVinyl(Graphics& g,
     g.setColour(Colour(0xFF3d4148));
     g.drawEllipse(rx, ry, rw, rw, 5.0f);
 
-    // Draw record grooves (concentric circles)
-    g.setColour(Colour(0xFF3d4148).withAlpha(0.7f));
-
-    // Create multiple grooves with varying opacity for realistic appearance
+    // Create multiple grooves (concentric circles) with varying opacity for realistic appearance
     for (float i = 0.9f; i > 0.35f; i -= 0.035f) {
         float grooveRadius = radius * i;
         // Slightly vary opacity for more realistic look
@@ -72,24 +120,11 @@ void DeckGUILookAndFeel::drawRotatoryVinyl(Graphics& g,
     g.setColour(Colours::black);
     g.fillEllipse(centreX - holeRadius, centreY - holeRadius,
                  holeRadius * 2.0f, holeRadius * 2.0f);
+}
 
-    Path p;
-    auto pointerThickness = 3.0f;
-    float outerPointerStart = -radius;
-    float outerPointerLength = radius * 0.65f; // Stops before the label
-
-    p.addRectangle(-pointerThickness * 0.5f, outerPointerStart,
-                  pointerThickness, outerPointerLength);
-
-    p.addRectangle(-pointerThickness * 0.5f, labelRadius,
-                  pointerThickness, outerPointerLength);
-
-    // Rotate line to current playback position
-    p.applyTransform(AffineTransform::rotation(angle).translated(centreX, centreY));
-
-    // Draw white position indicator
-    g.setColour(Colours::white);
-    g.fillPath(p);
+double DeckGUILookAndFeel::getAverageVinylPaintMicroseconds() const
+{
+    return averageVinylPaintMicroseconds;
 }
 
 // Main rotary slider drawing method - handles both standard knobs and vinyl control
@@ -54,5 +54,19 @@ public:
         const Slider::SliderStyle style,
         Slider& slider) override;
 
+    // Time spent in drawRotatoryVinyl per frame, averaged over roughly the last second
+    double getAverageVinylPaintMicroseconds() const;
 
+private:
+    // Draws the parts of the vinyl that don't turn (disc, rings, grooves, label, spindle hole)
+    // into platterImage, for a slider of the given size at the given pixel scale
+    void renderPlatter(int width, int height, float scale);
+
+    // The still parts of the vinyl, drawn again only when the size or scale changes
+    Image platterImage;
+    int platterWidth = 0;
+    int platterHeight = 0;
+    float platterScale = 0.0f;
+
+    double averageVinylPaintMicroseconds = 0.0;
 };
\ No newline at end of file
@@ -0,0 +1,457 @@
+#include "DeckManager.h"
+#include "RealtimeAllocationGuard.h"
+#include <vector>
+
+DeckManager::DeckManager()
+{
+    // Removed decks are freed by a timer that only runs while one is on its way back
+    // (or a command is held back), never on the audio thread
+}
+
+DeckManager::~DeckManager()
+{
+    // The audio device is shut down by now, so anything still queued can be freed here
+    stopTimer();
+    renderPool.stop();
+
+    // Decks waiting to be added are still owned by the deck list
+    Command command;
+    while (commands.pop(command))
+    {
+        if (command.type == Command::Type::remove)
+            delete command.deck;
+    }
+
+    for (auto& held : heldCommands)
+    {
+        if (held.type == Command::Type::remove)
+            delete held.deck;
+    }
+
+    collectRetiredDecks();
+}
+
+DJAudioPlayer* DeckManager::addDeck()
+{
+    const ScopedLock sl(prepareLock);
+    collectRetiredDecks();
+
+    if (decks.size() >= maxDecks)
+        return nullptr;
+
+    auto deck = std::make_unique<DJAudioPlayer>();
+
+    // A running device only prepares the decks it knows about, so a new one catches up here
+    if (isPrepared)
+        deck->prepareToPlay(preparedBlockSize, preparedSampleRate);
+
+    Command command;
+    command.type = Command::Type::add;
+    command.deck = deck.get();
+    sendCommand(command);
+
+    return decks.add(deck.release());
+}
+
+void DeckManager::removeDeck(DJAudioPlayer* deck)
+{
+    const ScopedLock sl(prepareLock);
+
+    if (!decks.contains(deck))
+        return;
+
+    // The queue owns the deck until the audio thread retires it
+    Command command;
+    command.type = Command::Type::remove;
+    command.deck = deck;
+    sendCommand(command);
+
+    decks.removeObject(deck, false);
+}
+
+int DeckManager::getNumDecks() const
+{
+    return decks.size();
+}
+
+DJAudioPlayer* DeckManager::getDeck(int index) const
+{
+    return decks[index];
+}
+
+void DeckManager::setParallelRendering(bool shouldRenderInParallel, int numWorkers)
+{
+    // The audio thread renders decks too, so more workers than decks minus one never help.
+    // On a single core no workers start and rendering stays serial.
+    const int spareCores = SystemStats::getNumCpus() - 1;
+    const ScopedLock sl(prepareLock);
+
+    if (shouldRenderInParallel)
+        renderPool.start(jmin(numWorkers > 0 ? numWorkers : spareCores, maxDecks - 1), getCallbackPeriodMs());
+    else
+        renderPool.stop();
+}
+
+double DeckManager::getCallbackPeriodMs() const
+{
+    // A typical device until the real one is known
+    if (!isPrepared || preparedSampleRate <= 0.0)
+        return 512.0 * 1000.0 / 44100.0;
+
+    return preparedBlockSize * 1000.0 / preparedSampleRate;
+}
+
+bool DeckManager::isParallelRenderingEnabled() const
+{
+    return renderPool.getNumWorkers() > 0;
+}
+
+double DeckManager::getRenderMicroseconds() const
+{
+    return renderMicroseconds;
+}
+
+void DeckManager::setCrossfaderAssignment(DJAudioPlayer* deck, Crossfader::Assignment assignment)
+{
+    Command command;
+    command.type = Command::Type::assign;
+    command.deck = deck;
+    command.assignment = assignment;
+    sendCommand(command);
+}
+
+Crossfader& DeckManager::getCrossfader()
+{
+    return crossfader;
+}
+
+double DeckManager::getMixMicroseconds() const
+{
+    return mixMicroseconds;
+}
+
+void DeckManager::timerCallback()
+{
+    collectRetiredDecks();
+    sendHeldCommands();
+
+    // Once the audio thread has taken every command, every deck it dropped has been deleted
+    if (heldCommands.empty() && commands.getNumReady() == 0 && retiredDecks.getNumReady() == 0)
+        stopTimer();
+}
+
+void DeckManager::sendCommand(const Command& command)
+{
+    // A removed deck comes back to be deleted, held commands need sending later
+    const bool needsService = command.type == Command::Type::remove || !heldCommands.empty() || commands.isFull();
+    if (needsService && !isTimerRunning())
+        startTimer(serviceIntervalMs);
+
+    // Commands never overtake held ones, so the audio thread sees them in the order they were sent
+    heldCommands.push_back(command);
+    if (sendHeldCommands())
+        return;
+
+    DBG("DeckManager::sendCommand command queue is full, " + String((int)heldCommands.size()) + " held back");
+}
+
+bool DeckManager::sendHeldCommands()
+{
+    while (!heldCommands.empty())
+    {
+        if (!commands.push(heldCommands.front()))
+            return false;
+
+        heldCommands.pop_front();
+    }
+
+    return true;
+}
+
+void DeckManager::collectRetiredDecks()
+{
+    DJAudioPlayer* retired = nullptr;
+    while (retiredDecks.pop(retired))
+    {
+        retired->releaseResources();
+        delete retired;
+    }
+}
+
+void DeckManager::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    const ScopedLock sl(prepareLock);
+
+    maxBlockSize = jmax(1, samplesPerBlockExpected);
+    preparedBlockSize = samplesPerBlockExpected;
+    preparedSampleRate = sampleRate;
+    isPrepared = true;
+
+    for (auto* deck : decks)
+        deck->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    // The callback is stopped while the device changes, so the workers can be rescheduled for its new period
+    const int numWorkers = renderPool.getNumWorkers();
+    if (numWorkers > 0 && renderPool.getPeriodMs() != getCallbackPeriodMs())
+        renderPool.start(numWorkers, getCallbackPeriodMs());
+
+    crossfader.prepare(sampleRate, maxBlockSize);
+
+    // Every deck's channels and the mix sit in one block, each slice starting on a SIMD boundary
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    sliceLength = (maxBlockSize + simdWidth - 1) / simdWidth * simdWidth;
+    sliceStorage.calloc((size_t)((maxDecks + 1) * numChannels * sliceLength + simdWidth));
+    slices = Vec::getNextSIMDAlignedPtr(sliceStorage.get());
+}
+
+void DeckManager::releaseResources()
+{
+    const ScopedLock sl(prepareLock);
+
+    isPrepared = false;
+    for (auto* deck : decks)
+        deck->releaseResources();
+
+    sliceStorage.free();
+    slices = nullptr;
+    sliceLength = 0;
+}
+
+float* DeckManager::getSlice(int slot, int channel) const
+{
+    return slices + (slot * numChannels + channel) * sliceLength;
+}
+
+void DeckManager::applyCommands()
+{
+    Command command;
+    while (commands.peek(command))
+    {
+        if (command.type == Command::Type::add)
+        {
+            // The deck list is capped at maxDecks, so there is always a free slot
+            jassert(numActiveDecks < maxDecks);
+            activeAssignments[(size_t)numActiveDecks] = Crossfader::Assignment::thru;
+            activeDecks[(size_t)numActiveDecks++] = command.deck;
+        }
+        else if (command.type == Command::Type::assign)
+        {
+            for (int slot = 0; slot < numActiveDecks; ++slot)
+            {
+                if (activeDecks[(size_t)slot] == command.deck)
+                    activeAssignments[(size_t)slot] = command.assignment;
+            }
+        }
+        else
+        {
+            // Retiring waits for the next block if the message thread hasn't caught up yet
+            if (retiredDecks.isFull())
+                return;
+
+            for (int slot = 0; slot < numActiveDecks; ++slot)
+            {
+                if (activeDecks[(size_t)slot] == command.deck)
+                {
+                    --numActiveDecks;
+                    activeDecks[(size_t)slot] = activeDecks[(size_t)numActiveDecks];
+                    activeAssignments[(size_t)slot] = activeAssignments[(size_t)numActiveDecks];
+                    break;
+                }
+            }
+
+            retiredDecks.push(command.deck);
+        }
+
+        commands.discardFront();
+    }
+}
+
+void DeckManager::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    // Decks added or removed since the last block
+    applyCommands();
+
+    const RealtimeAllocationGuard::ScopedNoAllocation noAllocation;
+
+    if (numActiveDecks == 0 || slices == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    AudioBuffer<float>& buffer = *bufferToFill.buffer;
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    const int numOutputChannels = jmin(buffer.getNumChannels(), (int)numChannels);
+    int64 renderTicks = 0;
+    int64 ticksSpent = 0;
+
+    // Hosts may hand us a bigger block than announced, so work in prepared-size chunks
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += maxBlockSize)
+    {
+        const int numThisTime = jmin(maxBlockSize, bufferToFill.numSamples - offset);
+        const int numPadded = (numThisTime + simdWidth - 1) / simdWidth * simdWidth;
+        const auto renderStartTicks = Time::getHighResolutionTicks();
+
+        // Falls back to rendering here, one deck after another, when the pool isn't running
+        numSamplesToRender = numThisTime;
+        if (numActiveDecks < 2 || !renderPool.run(*this, numActiveDecks))
+        {
+            for (int slot = 0; slot < numActiveDecks; ++slot)
+                runJob(slot);
+        }
+
+        const auto startTicks = Time::getHighResolutionTicks();
+        renderTicks += startTicks - renderStartTicks;
+
+        // Each deck is weighted by its side of the crossfader as it is summed
+        crossfader.fillGains(numThisTime);
+        const float* gains[maxDecks];
+        for (int slot = 0; slot < numActiveDecks; ++slot)
+            gains[slot] = crossfader.getGains(activeAssignments[(size_t)slot]);
+
+        for (int channel = 0; channel < numOutputChannels; ++channel)
+        {
+            const float* sources[maxDecks];
+            for (int slot = 0; slot < numActiveDecks; ++slot)
+                sources[slot] = getSlice(slot, channel);
+
+            // Straight into the output when it lines up, which is the usual case
+            float* out = buffer.getWritePointer(channel, bufferToFill.startSample + offset);
+            if (numPadded == numThisTime && Vec::isSIMDAligned(out))
+            {
+                sumSources(sources, gains, numActiveDecks, out, numThisTime);
+            }
+            else
+            {
+                float* mix = getSlice(maxDecks, channel);
+                sumSources(sources, gains, numActiveDecks, mix, numPadded);
+                FloatVectorOperations::copy(out, mix, numThisTime);
+            }
+        }
+
+        ticksSpent += Time::getHighResolutionTicks() - startTicks;
+    }
+
+    for (int channel = numOutputChannels; channel < buffer.getNumChannels(); ++channel)
+        buffer.clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+
+    const double renderElapsed = Time::highResolutionTicksToSeconds(renderTicks) * 1.0e6;
+    renderMicroseconds = renderMicroseconds + 0.05 * (renderElapsed - renderMicroseconds);
+
+    const double elapsed = Time::highResolutionTicksToSeconds(ticksSpent) * 1.0e6;
+    mixMicroseconds = mixMicroseconds + 0.05 * (elapsed - mixMicroseconds);
+}
+
+void DeckManager::runJob(int slot)
+{
+    float* channels[numChannels] = { getSlice(slot, 0), getSlice(slot, 1) };
+    AudioBuffer<float> deckBuffer(channels, numChannels, numSamplesToRender);
+    activeDecks[(size_t)slot]->getNextAudioBlock(AudioSourceChannelInfo(deckBuffer));
+}
+
+void DeckManager::sumSources(const float* const* sources, const float* const* gains, int numSources, float* dest, int numSamples)
+{
+    // Decks are the inner loop, so each output vector is loaded from every deck and stored once
+    for (int i = 0; i < numSamples; i += (int)Vec::SIMDNumElements)
+    {
+        Vec sum = Vec::fromRawArray(sources[0] + i) * Vec::fromRawArray(gains[0] + i);
+        for (int source = 1; source < numSources; ++source)
+            sum += Vec::fromRawArray(sources[source] + i) * Vec::fromRawArray(gains[source] + i);
+
+        sum.copyToRawArray(dest + i);
+    }
+}
+
+double DeckManager::measureMixNanosecondsPerSample(int numDecks, int blockSize)
+{
+    numDecks = jlimit(1, (int)maxDecks, numDecks);
+    blockSize = jmax(1, blockSize);
+    const double sampleRate = 44100.0;
+
+    DeckManager mixer;
+    std::vector<DJAudioPlayer*> mixDecks;
+    for (int i = 0; i < numDecks; ++i)
+    {
+        auto* deck = mixer.addDeck();
+        mixer.setCrossfaderAssignment(deck, i % 2 == 0 ? Crossfader::Assignment::left : Crossfader::Assignment::right);
+        mixDecks.push_back(deck);
+    }
+    mixer.prepareToPlay(blockSize, sampleRate);
+
+    // Two seconds of tone held in memory, looped, so no deck ever waits on a disk or stops
+    const int toneLength = (int)(2.0 * sampleRate);
+    for (auto* deck : mixDecks)
+    {
+        AudioBuffer<float> tone(numChannels, toneLength);
+        for (int i = 0; i < toneLength; ++i)
+        {
+            const float phase = MathConstants<float>::twoPi * 441.0f * (float)i / (float)sampleRate;
+            for (int channel = 0; channel < numChannels; ++channel)
+                tone.setSample(channel, i, 0.4f * std::sin(phase) + 0.1f * std::sin(5.0f * phase));
+        }
+
+        auto track = std::make_unique<DeckTrack>(URL(), sampleRate, (int64)toneLength, numChannels);
+        track->setHead(std::move(tone));
+        track->setPlaybackMode(DeckTrack::PlaybackMode::cached);
+        track->prepareToPlay(blockSize, sampleRate);
+
+        deck->loadTrack(std::move(track));
+        deck->setLooping(true);
+        deck->start();
+    }
+
+    // Two seconds' worth of blocks, after a few that pick up the commands and warm up the caches
+    AudioBuffer<float> output(numChannels, blockSize);
+    const int numBlocks = jmax(20, (int)(2.0 * sampleRate / blockSize));
+    int64 ticksSpent = 0;
+
+    for (int block = 0; block < numBlocks + 10; ++block)
+    {
+        const auto startTicks = Time::getHighResolutionTicks();
+        mixer.getNextAudioBlock(AudioSourceChannelInfo(output));
+
+        if (block >= 10)
+            ticksSpent += Time::getHighResolutionTicks() - startTicks;
+
+        // No message loop runs the decks' timers here, as in OfflineRenderer
+        for (auto* deck : mixDecks)
+            deck->serviceQueues();
+    }
+
+    mixer.releaseResources();
+    return Time::highResolutionTicksToSeconds(ticksSpent) * 1.0e9 / ((double)numBlocks * blockSize);
+}
+
+double DeckManager::measureSumNanosecondsPerSample(int numDecks, int blockSize)
+{
+    numDecks = jlimit(1, (int)maxDecks, numDecks);
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    const int length = (jmax(1, blockSize) + simdWidth - 1) / simdWidth * simdWidth;
+
+    HeapBlock<float> storage((size_t)((numDecks + 2) * length + simdWidth), true);
+    float* base = Vec::getNextSIMDAlignedPtr(storage.get());
+    const float* sources[maxDecks];
+    const float* gains[maxDecks];
+    for (int deck = 0; deck < numDecks; ++deck)
+    {
+        sources[deck] = base + deck * length;
+        gains[deck] = base + (numDecks + 1) * length;
+    }
+    float* dest = base + numDecks * length;
+
+    // Two stereo seconds' worth of blocks at 44.1 kHz, after a few to warm up the caches
+    const int numBlocks = jmax(20, 2 * 44100 / length);
+    int64 ticksSpent = 0;
+
+    for (int block = 0; block < numBlocks + 10; ++block)
+    {
+        const auto startTicks = Time::getHighResolutionTicks();
+        for (int channel = 0; channel < numChannels; ++channel)
+            sumSources(sources, gains, numDecks, dest, length);
+
+        if (block >= 10)
+            ticksSpent += Time::getHighResolutionTicks() - startTicks;
+    }
+
+    return Time::highResolutionTicksToSeconds(ticksSpent) * 1.0e9 / ((double)numBlocks * length);
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Crossfader.h"
+#include "DJAudioPlayer.h"
+#include "RealtimeWorkerPool.h"
+#include "SpscQueue.h"
+#include <array>
+#include <atomic>
+#include <deque>
+
+/**
+ * Owns the decks and mixes them, replacing a fixed pair of players
+ * in a MixerAudioSource.
+ * Decks are created and destroyed on the message thread at any time; the
+ * audio thread learns about them through a lock-free command queue and
+ * hands removed decks back for deletion, like DJAudioPlayer does with tracks.
+ * As there, commands that find the queue full are held back in order and sent
+ * later, so adding, removing or assigning a deck is never lost.
+ * Every deck renders into its own slice of one preallocated, SIMD-aligned
+ * block, then a single pass sums all of them through their crossfader gains,
+ * so the output is written once per block however many decks are playing.
+ * Decks can optionally render in parallel on a RealtimeWorkerPool. Each deck
+ * still writes only its own slice and the sum runs in the same order, so the
+ * output is identical to rendering them one after another, which is also what
+ * happens whenever the pool isn't running.
+ */
+class DeckManager : public AudioSource,
+    private RealtimeWorkerPool::Batch,
+    private Timer {
+public:
+    static constexpr int maxDecks = 8;
+    static constexpr int numChannels = 2;
+
+    DeckManager();
+    ~DeckManager() override;
+
+    // ==== Decks (message thread) ====
+    // Creates a deck at the end of the list, nullptr once maxDecks are in use
+    DJAudioPlayer* addDeck();
+    // Takes the deck out of the mix, it is deleted once the audio thread lets go of it
+    void removeDeck(DJAudioPlayer* deck);
+    int getNumDecks() const;
+    DJAudioPlayer* getDeck(int index) const;
+
+    // ==== Crossfader ====
+    // Which side of the crossfader a deck is on, new decks start as thru
+    void setCrossfaderAssignment(DJAudioPlayer* deck, Crossfader::Assignment assignment);
+    // Position and curve can be set from any thread
+    Crossfader& getCrossfader();
+
+    // ==== Parallel rendering (message thread) ====
+    // Renders the decks on real-time worker threads; 0 workers uses one per spare core
+    void setParallelRendering(bool shouldRenderInParallel, int numWorkers = 0);
+    bool isParallelRenderingEnabled() const;
+
+    // Average time per block for rendering all decks, to compare serial and parallel rendering
+    double getRenderMicroseconds() const;
+    // Average time the summing pass takes per block, not counting the decks themselves
+    double getMixMicroseconds() const;
+
+    // Times a whole mix of numDecks decks looping a tone at default settings, rendering plus
+    // summing, in ns per output sample (serial rendering, on the calling thread)
+    static double measureMixNanosecondsPerSample(int numDecks, int blockSize = 512);
+    // Times the summing pass on its own, in ns per output sample
+    static double measureSumNanosecondsPerSample(int numDecks, int blockSize = 512);
+
+    // ==== AudioSource interface methods ====
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    using Vec = dsp::SIMDRegister<float>;
+
+    struct Command {
+        enum class Type { add, remove, assign };
+        Type type = Type::add;
+        DJAudioPlayer* deck = nullptr;
+        Crossfader::Assignment assignment = Crossfader::Assignment::thru;
+    };
+
+    // Deletes decks the audio thread has dropped and sends held-back commands,
+    // only runs while something is on its way through the queues
+    void timerCallback() override;
+    void collectRetiredDecks();
+    static constexpr int serviceIntervalMs = 250;
+
+    // Message thread side of the command queue
+    void sendCommand(const Command& command);
+    // Pushes held-back commands until the queue is full again, true once none are left
+    bool sendHeldCommands();
+
+    // Audio thread helpers
+    void applyCommands();
+    float* getSlice(int slot, int channel) const;
+    // Renders the deck in this slot into its slices, from any thread
+    void runJob(int slot) override;
+
+    // Adds numSources aligned runs, each times its own gain run, into dest in one pass.
+    // numSamples must be a multiple of the SIMD width.
+    static void sumSources(const float* const* sources, const float* const* gains, int numSources, float* dest, int numSamples);
+
+    // ==== Message thread ====
+    OwnedArray<DJAudioPlayer> decks;  // In display order
+    std::deque<Command> heldCommands;  // Waiting for room in the queue
+    CriticalSection prepareLock;  // Keeps adding decks and (re)preparing the device apart
+    bool isPrepared = false;
+    int preparedBlockSize = 0;
+    double preparedSampleRate = 0.0;
+
+    // How often the audio thread renders a block, the render workers are scheduled for it
+    double getCallbackPeriodMs() const;
+
+    // ==== Shared between threads ====
+    SpscQueue<Command, 32> commands;
+    SpscQueue<DJAudioPlayer*, 2 * maxDecks> retiredDecks;
+    std::atomic<double> renderMicroseconds{ 0.0 };
+    std::atomic<double> mixMicroseconds{ 0.0 };
+    RealtimeWorkerPool renderPool;
+
+    // ==== Audio thread ====
+    std::array<DJAudioPlayer*, maxDecks> activeDecks{};
+    std::array<Crossfader::Assignment, maxDecks> activeAssignments{};
+    int numActiveDecks = 0;
+    Crossfader crossfader;
+
+    // One slice per deck and channel plus the mix, each sliceLength long and aligned
+    HeapBlock<float> sliceStorage;
+    float* slices = nullptr;
+    int sliceLength = 0;
+    int maxBlockSize = 0;
+    int numSamplesToRender = 0;  // Size of the chunk the decks are rendering
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckManager)
+};
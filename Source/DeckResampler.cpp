@@ -0,0 +1,398 @@
+#include "DeckResampler.h"
+#include <cstring>
+
+constexpr float DeckResampler::stretches[];
+
+namespace
+{
+    // Zeroth-order modified Bessel function, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Feeds the benchmark a steady test signal
+    class TestToneSource : public AudioSource {
+    public:
+        void prepareToPlay(int, double) override {}
+        void releaseResources() override {}
+        void getNextAudioBlock(const AudioSourceChannelInfo& info) override
+        {
+            // A cheap sawtooth, so the measurement is mostly the resampler
+            for (int i = 0; i < info.numSamples; ++i)
+            {
+                phase += 0.01f;
+                if (phase > 1.0f)
+                    phase -= 2.0f;
+
+                for (int channel = 0; channel < info.buffer->getNumChannels(); ++channel)
+                    info.buffer->setSample(channel, info.startSample + i, 0.5f * phase);
+            }
+        }
+
+    private:
+        float phase = 0.0f;
+    };
+}
+
+DeckResampler::DeckResampler(AudioSource* inputSource, int _numChannels)
+    : input(inputSource), numChannels(jmax(1, _numChannels))
+{
+    jassert(input != nullptr);
+
+    // The kernels only depend on the ratio, not on the sample rate, so they are built once
+    for (int i = 0; i < numStretches; ++i)
+        buildSincTable(sincTables[i], stretches[i]);
+}
+
+DeckResampler::~DeckResampler()
+{
+}
+
+const char* DeckResampler::getModeName(Mode mode)
+{
+    switch (mode)
+    {
+        case Mode::linear:   return "linear";
+        case Mode::lagrange: return "lagrange";
+        case Mode::sinc:     return "sinc";
+        default:             return "";
+    }
+}
+
+void DeckResampler::buildSincTable(SincTable& table, float stretch)
+{
+    // The cutoff sits a little below Nyquist (scaled down when speeding up) to leave room for the transition band
+    const double cutoff = 0.9 / stretch;
+    const double beta = 8.0;
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    table.halfWidth = (int)std::ceil(sincHalfWidth * stretch);
+    table.numTaps = 2 * table.halfWidth;
+    table.rowLength = (table.numTaps + simdWidth - 1 + simdWidth - 1) / simdWidth * simdWidth;
+
+    const int rowsPerOffset = numPhases + 1;
+    table.storage.calloc((size_t)(simdWidth * rowsPerOffset * table.rowLength + simdWidth));
+    table.coefficients = Vec::getNextSIMDAlignedPtr(table.storage.get());
+
+    std::vector<double> taps((size_t)table.numTaps);
+
+    for (int phase = 0; phase <= numPhases; ++phase)
+    {
+        const double fraction = (double)phase / numPhases;
+        double sum = 0.0;
+
+        for (int tap = 0; tap < table.numTaps; ++tap)
+        {
+            // Distance from the output position to the input sample this tap multiplies
+            const double distance = (double)(tap - table.halfWidth + 1) - fraction;
+            const double x = MathConstants<double>::pi * cutoff * distance;
+            const double sinc = distance == 0.0 ? 1.0 : std::sin(x) / x;
+            const double w = distance / table.halfWidth;
+            const double window = std::abs(w) >= 1.0 ? 0.0 : besselI0(beta * std::sqrt(1.0 - w * w)) / besselI0(beta);
+
+            taps[(size_t)tap] = sinc * window;
+            sum += taps[(size_t)tap];
+        }
+
+        // Unity gain at DC for every phase, so the level doesn't wobble with the fraction
+        for (int offset = 0; offset < simdWidth; ++offset)
+        {
+            float* row = table.coefficients + (offset * rowsPerOffset + phase) * table.rowLength + offset;
+            for (int tap = 0; tap < table.numTaps; ++tap)
+                row[tap] = (float)(taps[(size_t)tap] / sum);
+        }
+    }
+}
+
+int DeckResampler::getMaxHalfWidth()
+{
+    // Linear and Lagrange need 1 and 2, the widest sinc kernel needs the most
+    return (int)std::ceil(sincHalfWidth * stretches[numStretches - 1]);
+}
+
+const DeckResampler::SincTable& DeckResampler::chooseSincTable(double currentRatio) const
+{
+    for (int i = 0; i < numStretches; ++i)
+    {
+        if (currentRatio <= stretches[i])
+            return sincTables[i];
+    }
+
+    return sincTables[numStretches - 1];
+}
+
+void DeckResampler::setResamplingRatio(double samplesInPerOutputSample)
+{
+    ratio = jlimit(0.0, maxRatio, samplesInPerOutputSample);
+}
+
+double DeckResampler::getResamplingRatio() const
+{
+    return ratio;
+}
+
+void DeckResampler::setMode(Mode newMode)
+{
+    mode = newMode;
+}
+
+DeckResampler::Mode DeckResampler::getMode() const
+{
+    return mode;
+}
+
+double DeckResampler::getAverageNanosecondsPerSample() const
+{
+    return averageNanoseconds;
+}
+
+void DeckResampler::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    maxBlockSize = jmax(1, samplesPerBlockExpected);
+
+    // One block at the fastest ratio, the kernel reach on both sides, and a block of slack for compacting
+    const int maxHalfWidth = getMaxHalfWidth();
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    historyCapacity = (int)std::ceil(maxBlockSize * maxRatio) + 4 * maxHalfWidth + maxBlockSize + 2 * simdWidth;
+
+    // Extra room per channel so each channel can start on a SIMD boundary
+    const int channelStride = historyCapacity + simdWidth;
+    historyStorage.calloc((size_t)(channelStride * numChannels));
+    history.calloc((size_t)numChannels);
+    for (int channel = 0; channel < numChannels; ++channel)
+        history[channel] = Vec::getNextSIMDAlignedPtr(historyStorage + channel * channelStride);
+
+    reset();
+}
+
+void DeckResampler::releaseResources()
+{
+    input->releaseResources();
+    historyStorage.free();
+    history.free();
+    historyCapacity = 0;
+}
+
+void DeckResampler::flushBuffers()
+{
+    reset();
+}
+
+void DeckResampler::reset()
+{
+    // Start with silence behind the first sample, so every kernel has a full history
+    const int maxHalfWidth = getMaxHalfWidth();
+    for (int channel = 0; channel < numChannels; ++channel)
+        FloatVectorOperations::clear(history[channel], maxHalfWidth);
+
+    historyValid = maxHalfWidth;
+    readPosition = (double)maxHalfWidth;
+}
+
+void DeckResampler::pullInput(int numNeeded)
+{
+    jassert(numNeeded <= historyCapacity);
+    numNeeded = jmin(numNeeded, historyCapacity);
+
+    // Read in blocks no bigger than the input was prepared for, written straight into the history
+    while (historyValid < numNeeded)
+    {
+        const int numThisTime = jmin(maxBlockSize, numNeeded - historyValid);
+        AudioBuffer<float> view(history.get(), numChannels, historyValid, numThisTime);
+        input->getNextAudioBlock(AudioSourceChannelInfo(view));
+        historyValid += numThisTime;
+    }
+}
+
+void DeckResampler::discardInput()
+{
+    // Keep enough behind the read position for the widest kernel, so modes can switch at any time.
+    // Moving in SIMD-width steps keeps every sample on the same alignment.
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    int keepFrom = (int)readPosition - getMaxHalfWidth();
+    keepFrom -= keepFrom % simdWidth;
+
+    // Compact only once a block's worth can go, so the move is amortised
+    if (keepFrom < maxBlockSize)
+        return;
+
+    const int numLeft = historyValid - keepFrom;
+    for (int channel = 0; channel < numChannels; ++channel)
+        std::memmove(history[channel], history[channel] + keepFrom, sizeof(float) * (size_t)numLeft);
+
+    historyValid = numLeft;
+    readPosition -= keepFrom;
+}
+
+void DeckResampler::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    // Not prepared yet
+    if (historyCapacity == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    const double currentRatio = ratio;
+    const Mode currentMode = mode;
+    AudioBuffer<float>& buffer = *bufferToFill.buffer;
+    int64 ticksSpent = 0;
+
+    // Hosts may hand us a bigger block than announced, so work in prepared-size chunks
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += maxBlockSize)
+    {
+        const int numThisTime = jmin(maxBlockSize, bufferToFill.numSamples - offset);
+        const int reach = currentMode == Mode::sinc ? chooseSincTable(currentRatio).halfWidth : 2;
+
+        // Everything up to the last tap of the last output sample
+        pullInput((int)(readPosition + (numThisTime - 1) * currentRatio) + reach + 1);
+
+        const auto startTicks = Time::getHighResolutionTicks();
+
+        if (currentMode == Mode::linear)
+            processLinear(buffer, bufferToFill.startSample + offset, numThisTime, currentRatio);
+        else if (currentMode == Mode::lagrange)
+            processLagrange(buffer, bufferToFill.startSample + offset, numThisTime, currentRatio);
+        else
+            processSinc(buffer, bufferToFill.startSample + offset, numThisTime, currentRatio);
+
+        ticksSpent += Time::getHighResolutionTicks() - startTicks;
+
+        readPosition += numThisTime * currentRatio;
+        discardInput();
+    }
+
+    for (int channel = numChannels; channel < buffer.getNumChannels(); ++channel)
+        buffer.clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+
+    if (bufferToFill.numSamples > 0)
+    {
+        const double nanoseconds = Time::highResolutionTicksToSeconds(ticksSpent) * 1.0e9 / bufferToFill.numSamples;
+        averageNanoseconds = averageNanoseconds + 0.05 * (nanoseconds - averageNanoseconds);
+    }
+}
+
+void DeckResampler::processLinear(AudioBuffer<float>& buffer, int startSample, int numSamples, double currentRatio)
+{
+    const int numOutputChannels = jmin(buffer.getNumChannels(), numChannels);
+
+    for (int channel = 0; channel < numOutputChannels; ++channel)
+    {
+        const float* in = history[channel];
+        float* out = buffer.getWritePointer(channel, startSample);
+        double position = readPosition;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const int index = (int)position;
+            const float fraction = (float)(position - index);
+            out[i] = in[index] + fraction * (in[index + 1] - in[index]);
+            position += currentRatio;
+        }
+    }
+}
+
+void DeckResampler::processLagrange(AudioBuffer<float>& buffer, int startSample, int numSamples, double currentRatio)
+{
+    const int numOutputChannels = jmin(buffer.getNumChannels(), numChannels);
+    double position = readPosition;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int index = (int)position;
+        const float f = (float)(position - index);
+
+        // Third-order Lagrange weights for the samples at -1, 0, 1 and 2
+        const float c0 = -f * (f - 1.0f) * (f - 2.0f) / 6.0f;
+        const float c1 = (f + 1.0f) * (f - 1.0f) * (f - 2.0f) / 2.0f;
+        const float c2 = -(f + 1.0f) * f * (f - 2.0f) / 2.0f;
+        const float c3 = (f + 1.0f) * f * (f - 1.0f) / 6.0f;
+
+        for (int channel = 0; channel < numOutputChannels; ++channel)
+        {
+            const float* in = history[channel] + index;
+            buffer.getWritePointer(channel, startSample)[i] = c0 * in[-1] + c1 * in[0] + c2 * in[1] + c3 * in[2];
+        }
+
+        position += currentRatio;
+    }
+}
+
+void DeckResampler::processSinc(AudioBuffer<float>& buffer, int startSample, int numSamples, double currentRatio)
+{
+    const SincTable& table = chooseSincTable(currentRatio);
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    const int numOutputChannels = jmin(buffer.getNumChannels(), numChannels);
+    double position = readPosition;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int index = (int)position;
+        const double phase = (position - index) * numPhases;
+        const int phaseIndex = jmin((int)phase, numPhases - 1);
+        const Vec phaseFraction = Vec::expand((float)(phase - phaseIndex));
+
+        // Start the dot product on the aligned sample at or before the first tap,
+        // and use the copy of the kernel shifted by the same amount
+        const int firstTap = index - table.halfWidth + 1;
+        const int offset = firstTap % simdWidth;
+        const int alignedStart = firstTap - offset;
+        const float* row0 = table.coefficients + (offset * (numPhases + 1) + phaseIndex) * table.rowLength;
+        const float* row1 = row0 + table.rowLength;
+
+        // Both channels share each interpolated coefficient
+        for (int channel = 0; channel < numOutputChannels; channel += 2)
+        {
+            const float* left = history[channel] + alignedStart;
+            const float* right = history[jmin(channel + 1, numOutputChannels - 1)] + alignedStart;
+            Vec sumLeft = Vec::expand(0.0f);
+            Vec sumRight = Vec::expand(0.0f);
+
+            for (int k = 0; k < table.rowLength; k += simdWidth)
+            {
+                const Vec c0 = Vec::fromRawArray(row0 + k);
+                const Vec coefficients = c0 + (Vec::fromRawArray(row1 + k) - c0) * phaseFraction;
+                sumLeft += coefficients * Vec::fromRawArray(left + k);
+                sumRight += coefficients * Vec::fromRawArray(right + k);
+            }
+
+            buffer.getWritePointer(channel, startSample)[i] = sumLeft.sum();
+            if (channel + 1 < numOutputChannels)
+                buffer.getWritePointer(channel + 1, startSample)[i] = sumRight.sum();
+        }
+
+        position += currentRatio;
+    }
+}
+
+double DeckResampler::measureNanosecondsPerSample(Mode modeToMeasure, double ratioToMeasure, double sampleRate)
+{
+    const int blockSize = 512;
+    TestToneSource tone;
+    DeckResampler resampler(&tone, 2);
+    resampler.prepareToPlay(blockSize, sampleRate);
+    resampler.setMode(modeToMeasure);
+    resampler.setResamplingRatio(ratioToMeasure);
+
+    // A couple of seconds of audio, the first blocks only warm up the caches
+    AudioBuffer<float> output(2, blockSize);
+    const int numBlocks = jmax(20, (int)(2.0 * sampleRate / blockSize));
+    int64 ticksSpent = 0;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        const auto startTicks = Time::getHighResolutionTicks();
+        resampler.getNextAudioBlock(AudioSourceChannelInfo(output));
+        if (block >= 10)
+            ticksSpent += Time::getHighResolutionTicks() - startTicks;
+    }
+
+    return Time::highResolutionTicksToSeconds(ticksSpent) * 1.0e9 / ((numBlocks - 10) * (double)blockSize);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+ * Variable-rate resampler for the deck's speed control, a drop-in
+ * replacement for ResamplingAudioSource with selectable interpolation:
+ *  - linear:   2 taps, cheapest, aliases when speeding up
+ *  - lagrange: 4-tap third-order polynomial
+ *  - sinc:     polyphase Kaiser-windowed sinc; when speeding up, the kernel
+ *              widens and its cutoff drops with the ratio so nothing folds back
+ * The sinc kernel filters both channels per coefficient load with
+ * SIMDRegister on aligned history and coefficient buffers.
+ * Everything is sized in prepareToPlay, mode and ratio changes never allocate.
+ */
+class DeckResampler : public AudioSource {
+public:
+    enum class Mode { linear, lagrange, sinc };
+
+    static const char* getModeName(Mode mode);
+
+    // Fastest supported ratio, higher ones are clamped. The sinc kernels anti-alias all the way up to it.
+    static constexpr double maxRatio = 8.0;
+
+    // The input is not owned
+    DeckResampler(AudioSource* inputSource, int numChannels = 2);
+    ~DeckResampler() override;
+
+    // Input samples consumed per output sample (2.0 = twice as fast)
+    void setResamplingRatio(double samplesInPerOutputSample);
+    double getResamplingRatio() const;
+
+    // Takes effect on the next block without a glitch
+    void setMode(Mode newMode);
+    Mode getMode() const;
+
+    // Drops the interpolation history, e.g. after a seek (audio thread)
+    void flushBuffers();
+
+    // Average cost of the interpolation itself, not counting reading the input
+    double getAverageNanosecondsPerSample() const;
+
+    // Runs a mode on a test tone off the audio thread and returns its cost in ns per output sample
+    static double measureNanosecondsPerSample(Mode mode, double ratio, double sampleRate = 44100.0);
+
+    // ==== AudioSource interface methods ====
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    using Vec = dsp::SIMDRegister<float>;
+
+    // Sinc kernels are built for a few widening factors up to maxRatio, the closest one at or above the ratio is used
+    static constexpr int numStretches = 7;
+    static constexpr float stretches[numStretches] = { 1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f };
+    static_assert(stretches[numStretches - 1] >= maxRatio, "every ratio needs a wide enough sinc kernel");
+    static constexpr int sincHalfWidth = 12;  // Taps each side at ratios up to 1
+    static constexpr int numPhases = 256;
+
+    // Every phase is stored once per SIMD lane offset, with zeros in front, so a kernel can
+    // always be lined up with an aligned run of history
+    struct SincTable {
+        int halfWidth = 0;
+        int numTaps = 0;
+        int rowLength = 0;  // numTaps plus the leading zeros, rounded up to the SIMD width
+        HeapBlock<float> storage;
+        float* coefficients = nullptr;  // [lane offset][numPhases + 1][rowLength], aligned
+    };
+
+    void buildSincTable(SincTable& table, float stretch);
+    const SincTable& chooseSincTable(double ratio) const;
+    static int getMaxHalfWidth();
+
+    void reset();
+    void pullInput(int numNeeded);
+    void discardInput();
+
+    void processLinear(AudioBuffer<float>& buffer, int startSample, int numSamples, double ratio);
+    void processLagrange(AudioBuffer<float>& buffer, int startSample, int numSamples, double ratio);
+    void processSinc(AudioBuffer<float>& buffer, int startSample, int numSamples, double ratio);
+
+    AudioSource* input;
+    const int numChannels;
+    int maxBlockSize = 0;
+
+    // Input history per channel, aligned for SIMD loads. Index 0 is the oldest kept sample.
+    HeapBlock<float> historyStorage;
+    HeapBlock<float*> history;
+    int historyCapacity = 0;
+    int historyValid = 0;
+    double readPosition = 0.0;  // Where the next output sample sits in the history
+
+    SincTable sincTables[numStretches];
+
+    std::atomic<double> ratio{ 1.0 };
+    std::atomic<Mode> mode{ Mode::sinc };
+    std::atomic<double> averageNanoseconds{ 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckResampler)
+};
@@ -0,0 +1,240 @@
+#include "DeckStreamingService.h"
+
+StreamingSource::StreamingSource(PositionableAudioSource* sourceToStream,
+        TimeSliceThread& _thread,
+        int readAheadSamples,
+        int _numChannels,
+        std::atomic<int>& sharedUnderrunCounter)
+    : source(sourceToStream),
+      thread(_thread),
+      readAhead(jmax(1, readAheadSamples)),
+      numChannels(jmax(1, _numChannels)),
+      totalUnderruns(sharedUnderrunCounter)
+{
+}
+
+StreamingSource::~StreamingSource()
+{
+    // Waits for a read in progress, after that the worker never calls us again
+    thread.removeTimeSliceClient(this);
+}
+
+void StreamingSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    // Only one thread fills the ring at a time, so the worker lets go while we prefill
+    thread.removeTimeSliceClient(this);
+    source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    // At least a few device blocks, so a short read-ahead can't underrun every block
+    ring.setSize(numChannels, jmax(readAhead, 4 * samplesPerBlockExpected));
+    ring.clear();
+    validStart = validEnd = readPosition.load();
+    filledGeneration = seekGeneration.load();
+
+    while (useTimeSlice() == 0)
+    {
+    }
+
+    thread.addTimeSliceClient(this);
+}
+
+void StreamingSource::releaseResources()
+{
+    thread.removeTimeSliceClient(this);
+    source->releaseResources();
+    ring.setSize(0, 0);
+}
+
+void StreamingSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    const int64 position = readPosition;
+    const int ringSize = ring.getNumSamples();
+    readPosition = position + bufferToFill.numSamples;
+
+    // The range is only read once the worker has caught up with our last backward seek,
+    // and it only ever grows past the playhead, so what is in it stays put while we copy
+    int numReady = 0;
+    if (ringSize > 0 && filledGeneration.load() == seekGeneration.load())
+    {
+        const int64 start = validStart;
+        const int64 end = validEnd;
+        if (position >= start && position < end)
+            numReady = (int)jmin((int64)bufferToFill.numSamples, end - position);
+    }
+
+    const int outputChannels = bufferToFill.buffer->getNumChannels();
+    for (int done = 0; done < numReady;)
+    {
+        const int index = (int)((position + done) % ringSize);
+        const int numThisTime = jmin(numReady - done, ringSize - index);
+
+        // Mono streams feed every output channel
+        for (int channel = 0; channel < outputChannels; ++channel)
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + done,
+                ring, channel % numChannels, index, numThisTime);
+
+        done += numThisTime;
+    }
+
+    if (numReady < bufferToFill.numSamples)
+    {
+        // Never wait for the worker here, what isn't decoded yet plays as silence
+        for (int channel = 0; channel < outputChannels; ++channel)
+            bufferToFill.buffer->clear(channel, bufferToFill.startSample + numReady, bufferToFill.numSamples - numReady);
+
+        ++underruns;
+        ++totalUnderruns;
+    }
+}
+
+void StreamingSource::setNextReadPosition(int64 newPosition)
+{
+    const int64 position = readPosition;
+    if (newPosition == position)
+        return;
+
+    // The worker only writes over positions behind the playhead it last saw, so going
+    // forward is safe; going back could meet samples it is overwriting, so the ring is dropped
+    readPosition = newPosition;
+    if (newPosition < position)
+        ++seekGeneration;
+}
+
+int64 StreamingSource::getNextReadPosition() const
+{
+    const int64 length = source->getTotalLength();
+    const int64 position = readPosition;
+    return source->isLooping() && length > 0 ? position % length : position;
+}
+
+int64 StreamingSource::getTotalLength() const
+{
+    return source->getTotalLength();
+}
+
+bool StreamingSource::isLooping() const
+{
+    return source->isLooping();
+}
+
+void StreamingSource::setLooping(bool shouldLoop)
+{
+    source->setLooping(shouldLoop);
+}
+
+int StreamingSource::getUnderrunCount() const
+{
+    return underruns;
+}
+
+int StreamingSource::getReadAheadSamples() const
+{
+    return readAhead;
+}
+
+int StreamingSource::useTimeSlice()
+{
+    const int ringSize = ring.getNumSamples();
+    if (ringSize == 0)
+        return 100;
+
+    // The generation is read first: a seek stores its position before bumping it
+    const uint32 generation = seekGeneration;
+    const int64 position = readPosition;
+    int64 start = validStart;
+    int64 end = validEnd;
+
+    // After a backward seek, or once the playhead has run past everything decoded,
+    // start again from the playhead. The range is published before the generation.
+    if (generation != filledGeneration.load() || position < start || position > end)
+    {
+        start = end = position;
+        validStart = start;
+        validEnd = end;
+        filledGeneration = generation;
+    }
+
+    // Reads in chunks, so a seek never waits behind a whole ring of decoding
+    const int64 space = position + ringSize - end;
+    const int chunkSize = jmax(1024, ringSize / 8);
+    if (space < chunkSize && end > position)
+        return space > 0 ? 5 : 10;
+
+    const int numToRead = (int)jmin(space, (int64)chunkSize);
+
+    // The oldest samples make room first, then the new ones become visible
+    validStart = jmax(start, end + numToRead - ringSize);
+    readIntoRing(end, numToRead);
+    validEnd = end + numToRead;
+
+    // 0 asks for another slice straight away, the ring isn't full yet
+    return end + numToRead < position + ringSize ? 0 : 1;
+}
+
+void StreamingSource::readIntoRing(int64 position, int numSamples)
+{
+    const int ringSize = ring.getNumSamples();
+    if (source->getNextReadPosition() != position)
+        source->setNextReadPosition(position);
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int index = (int)((position + done) % ringSize);
+        const int numThisTime = jmin(numSamples - done, ringSize - index);
+        source->getNextAudioBlock(AudioSourceChannelInfo(&ring, index, numThisTime));
+        done += numThisTime;
+    }
+}
+
+//==============================================================================
+DeckStreamingService::DeckStreamingService(int numWorkerThreads)
+{
+    for (int i = 0; i < jmax(1, numWorkerThreads); ++i)
+    {
+        auto* worker = workers.add(new TimeSliceThread("Deck streaming " + String(i + 1)));
+        worker->startThread(Thread::Priority::high);
+    }
+}
+
+DeckStreamingService::~DeckStreamingService()
+{
+    // All decks must have released their streams before the workers go away
+    for (auto* worker : workers)
+        worker->stopThread(2000);
+}
+
+void DeckStreamingService::setDefaultReadAheadSamples(int numSamples)
+{
+    defaultReadAhead = jmax(1024, numSamples);
+}
+
+int DeckStreamingService::getDefaultReadAheadSamples() const
+{
+    return defaultReadAhead;
+}
+
+StreamingSource* DeckStreamingService::createSource(PositionableAudioSource* sourceToStream,
+    int readAheadSamples,
+    int numChannels)
+{
+    // Spread decks over the workers, the one with the fewest streams gets the new track
+    TimeSliceThread* worker = workers.getFirst();
+    for (auto* candidate : workers)
+    {
+        if (candidate->getNumClients() < worker->getNumClients())
+            worker = candidate;
+    }
+
+    const int readAhead = readAheadSamples > 0 ? readAheadSamples : getDefaultReadAheadSamples();
+    return new StreamingSource(sourceToStream, *worker, readAhead, numChannels, totalUnderruns);
+}
+
+int DeckStreamingService::getNumWorkerThreads() const
+{
+    return workers.size();
+}
+
+int DeckStreamingService::getTotalUnderrunCount() const
+{
+    return totalUnderruns;
+}
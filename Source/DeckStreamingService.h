@@ -0,0 +1,101 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+ * Read-ahead buffered track stream handed to a deck's transport.
+ * A TimeSliceThread decodes ahead of the playhead into a ring of samples; the
+ * audio thread only ever copies out of that ring, with no lock and no wait.
+ * Every block the audio thread asks for before the worker has it ready is
+ * counted as an underrun and played as silence instead of blocking.
+ * The ring holds samples for a range of track positions that the worker only
+ * ever extends past the playhead, so the two threads never touch the same
+ * samples. Seeking forward keeps what is buffered; seeking back starts a new
+ * generation, and the ring is ignored until the worker has refilled it from there.
+ */
+class StreamingSource : public PositionableAudioSource,
+    private TimeSliceClient {
+public:
+    // Takes ownership of the source to stream
+    StreamingSource(PositionableAudioSource* sourceToStream,
+        TimeSliceThread& thread,
+        int readAheadSamples,
+        int numChannels,
+        std::atomic<int>& sharedUnderrunCounter);
+    ~StreamingSource() override;
+
+    // ==== PositionableAudioSource interface methods ====
+    // Prefills the ring before the worker takes over, so this may wait for the disk
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+    void setNextReadPosition(int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override;
+    void setLooping(bool shouldLoop) override;
+
+    // Blocks that were not decoded in time since this track was loaded
+    int getUnderrunCount() const;
+    int getReadAheadSamples() const;
+
+private:
+    // Worker side: reads the next chunk into the ring, returns the ms until it wants to run again
+    int useTimeSlice() override;
+    // Reads numSamples from the source, starting at the given track position, into the ring
+    void readIntoRing(int64 position, int numSamples);
+
+    std::unique_ptr<PositionableAudioSource> source;
+    TimeSliceThread& thread;
+    int readAhead;
+    int numChannels;
+
+    // Samples for track positions [validStart, validEnd), position p at index p % ring size
+    AudioBuffer<float> ring;
+    std::atomic<int64> validStart{ 0 };
+    std::atomic<int64> validEnd{ 0 };
+    // Bumped by every backward seek, the ring only counts once the worker has caught up with it
+    std::atomic<uint32> seekGeneration{ 0 };
+    std::atomic<uint32> filledGeneration{ 0 };
+    std::atomic<int64> readPosition{ 0 };  // Written by whoever plays the track
+
+    std::atomic<int> underruns{ 0 };
+    std::atomic<int>& totalUnderruns;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StreamingSource)
+};
+
+/**
+ * Disk streaming layer shared by all decks.
+ * Owns one or more TimeSliceThread workers that read and decode tracks ahead
+ * of the playhead, so slow disks and heavy codecs never run on the audio thread.
+ */
+class DeckStreamingService {
+public:
+    static constexpr int defaultReadAheadSamples = 65536;
+
+    explicit DeckStreamingService(int numWorkerThreads = 1);
+    ~DeckStreamingService();
+
+    // Default read-ahead for decks that don't choose their own, in samples
+    void setDefaultReadAheadSamples(int numSamples);
+    int getDefaultReadAheadSamples() const;
+
+    // Wraps a positionable source (taking ownership) in a buffered stream
+    // on the least busy worker. A readAheadSamples of 0 uses the default.
+    StreamingSource* createSource(PositionableAudioSource* sourceToStream,
+        int readAheadSamples = 0,
+        int numChannels = 2);
+
+    int getNumWorkerThreads() const;
+
+    // Underruns across all decks since the service was created
+    int getTotalUnderrunCount() const;
+
+private:
+    OwnedArray<TimeSliceThread> workers;
+    std::atomic<int> defaultReadAhead{ defaultReadAheadSamples };
+    std::atomic<int> totalUnderruns{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckStreamingService)
+};
@@ -0,0 +1,165 @@
+#include "DeckTrack.h"
+
+DeckTrack::DeckTrack(const URL& _url, double _sampleRate, int64 _lengthInSamples, int _numChannels)
+    : url(_url), sampleRate(_sampleRate), lengthInSamples(_lengthInSamples), numChannels(_numChannels)
+{
+}
+
+DeckTrack::~DeckTrack()
+{
+}
+
+const char* DeckTrack::getPlaybackModeName(PlaybackMode mode)
+{
+    switch (mode)
+    {
+        case PlaybackMode::streamed:     return "STREAM";
+        case PlaybackMode::cached:       return "RAM";
+        case PlaybackMode::memoryMapped: return "MAPPED";
+        default:                         return "";
+    }
+}
+
+void DeckTrack::setHead(AudioBuffer<float>&& decodedHead)
+{
+    head = std::move(decodedHead);
+}
+
+void DeckTrack::setBody(std::unique_ptr<PositionableAudioSource> bodySource)
+{
+    body = std::move(bodySource);
+
+    // Park the body where the head ends, so it buffers exactly what comes next
+    if (body != nullptr)
+        body->setNextReadPosition(jmax(position, getHeadLength()));
+}
+
+void DeckTrack::setPlaybackMode(PlaybackMode newMode)
+{
+    playbackMode = newMode;
+}
+
+void DeckTrack::prepareToPlay(int samplesPerBlockExpected, double _sampleRate)
+{
+    if (body != nullptr)
+        body->prepareToPlay(samplesPerBlockExpected, _sampleRate);
+
+    preparedBlockSize = samplesPerBlockExpected;
+    preparedSampleRate = _sampleRate;
+}
+
+void DeckTrack::releaseResources()
+{
+    if (body != nullptr)
+        body->releaseResources();
+
+    preparedBlockSize = 0;
+    preparedSampleRate = 0.0;
+}
+
+void DeckTrack::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    AudioBuffer<float>& buffer = *bufferToFill.buffer;
+    const int64 headLength = getHeadLength();
+    int numDone = 0;
+
+    // Serve what we can from the decoded head
+    if (position < headLength)
+    {
+        numDone = (int)jmin((int64)bufferToFill.numSamples, headLength - position);
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            // Mono files feed every output channel
+            buffer.copyFrom(channel, bufferToFill.startSample,
+                head, channel % head.getNumChannels(), (int)position, numDone);
+        }
+
+        position += numDone;
+    }
+
+    // The body was parked at the end of the head, so it continues seamlessly
+    if (numDone < bufferToFill.numSamples)
+    {
+        const int numLeft = bufferToFill.numSamples - numDone;
+        AudioSourceChannelInfo rest(bufferToFill.buffer, bufferToFill.startSample + numDone, numLeft);
+
+        if (body != nullptr && position < lengthInSamples)
+            body->getNextAudioBlock(rest);
+        else
+            rest.clearActiveBufferRegion();
+
+        position += numLeft;
+    }
+}
+
+void DeckTrack::setNextReadPosition(int64 newPosition)
+{
+    position = jmax((int64)0, newPosition);
+
+    if (body != nullptr)
+        body->setNextReadPosition(jmax(position, getHeadLength()));
+}
+
+int64 DeckTrack::getNextReadPosition() const
+{
+    return position;
+}
+
+int64 DeckTrack::getTotalLength() const
+{
+    return lengthInSamples;
+}
+
+bool DeckTrack::isLooping() const
+{
+    return false;
+}
+
+const URL& DeckTrack::getURL() const
+{
+    return url;
+}
+
+double DeckTrack::getSampleRate() const
+{
+    return sampleRate;
+}
+
+double DeckTrack::getLengthInSeconds() const
+{
+    return sampleRate > 0.0 ? (double)lengthInSamples / sampleRate : 0.0;
+}
+
+int DeckTrack::getNumChannels() const
+{
+    return numChannels;
+}
+
+int64 DeckTrack::getHeadLength() const
+{
+    return head.getNumChannels() > 0 ? (int64)head.getNumSamples() : 0;
+}
+
+PositionableAudioSource* DeckTrack::getBody() const
+{
+    return body.get();
+}
+
+DeckTrack::PlaybackMode DeckTrack::getPlaybackMode() const
+{
+    return playbackMode;
+}
+
+int DeckTrack::getUnderrunCount() const
+{
+    if (auto* stream = dynamic_cast<StreamingSource*>(body.get()))
+        return stream->getUnderrunCount();
+
+    return 0;
+}
+
+bool DeckTrack::isPreparedFor(int samplesPerBlockExpected, double _sampleRate) const
+{
+    return preparedBlockSize == samplesPerBlockExpected && preparedSampleRate == _sampleRate;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DeckStreamingService.h"
+
+/**
+ * A track that is ready to be played by a deck.
+ * Streamed tracks have their first few seconds decoded into memory up front,
+ * so playback and cue jumps to the start never wait on the disk; the rest of
+ * the file comes from the body source (a read-ahead stream). Cached and
+ * memory-mapped tracks are read straight from memory and have no head.
+ * Built and prepared by TrackLoader off the audio thread, then handed to
+ * DJAudioPlayer with a single pointer swap.
+ */
+class DeckTrack : public PositionableAudioSource {
+public:
+    // Where the body's samples come from
+    enum class PlaybackMode {
+        none,          // No track loaded (only reported by DJAudioPlayer)
+        streamed,      // Decoded on a read-ahead worker thread
+        cached,        // Fully decoded in the shared DecodedTrackCache
+        memoryMapped   // Uncompressed file mapped into memory and read in place
+    };
+
+    static const char* getPlaybackModeName(PlaybackMode mode);
+
+    DeckTrack(const URL& url, double sampleRate, int64 lengthInSamples, int numChannels);
+    ~DeckTrack() override;
+
+    // The decoded start of the file, played before the body takes over
+    void setHead(AudioBuffer<float>&& decodedHead);
+    // The source for everything after the head (takes ownership)
+    void setBody(std::unique_ptr<PositionableAudioSource> bodySource);
+    void setPlaybackMode(PlaybackMode newMode);
+
+    // ==== PositionableAudioSource interface methods ====
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+    void setNextReadPosition(int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    // ==== Track information ====
+    const URL& getURL() const;
+    double getSampleRate() const;
+    double getLengthInSeconds() const;
+    int getNumChannels() const;
+    int64 getHeadLength() const;
+    PositionableAudioSource* getBody() const;
+    PlaybackMode getPlaybackMode() const;
+
+    // Blocks the streamed body could not deliver in time (0 if it isn't streamed)
+    int getUnderrunCount() const;
+
+    // True when prepareToPlay was last called with this block size and rate
+    bool isPreparedFor(int samplesPerBlockExpected, double sampleRate) const;
+
+private:
+    URL url;
+    double sampleRate;
+    int64 lengthInSamples;
+    int numChannels;
+
+    AudioBuffer<float> head;
+    std::unique_ptr<PositionableAudioSource> body;
+    PlaybackMode playbackMode = PlaybackMode::streamed;
+    int64 position = 0;
+
+    int preparedBlockSize = 0;
+    double preparedSampleRate = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckTrack)
+};
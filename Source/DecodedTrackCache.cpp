@@ -0,0 +1,261 @@
+#include "DecodedTrackCache.h"
+#include <chrono>
+#include <limits>
+
+int64 DecodedTrack::getSizeInBytes() const
+{
+    return (int64)buffer.getNumChannels() * (int64)buffer.getNumSamples() * (int64)sizeof(float);
+}
+
+//==============================================================================
+CachedTrackSource::CachedTrackSource(std::shared_ptr<const DecodedTrack> decodedTrack)
+    : track(std::move(decodedTrack))
+{
+}
+
+CachedTrackSource::~CachedTrackSource()
+{
+}
+
+void CachedTrackSource::prepareToPlay(int, double)
+{
+    // Nothing to prepare, the whole track is already in memory
+}
+
+void CachedTrackSource::releaseResources()
+{
+}
+
+void CachedTrackSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    AudioBuffer<float>& buffer = *bufferToFill.buffer;
+    const AudioBuffer<float>& source = track->buffer;
+    const int numAvailable = (int)jlimit((int64)0, (int64)bufferToFill.numSamples,
+        (int64)source.getNumSamples() - position);
+
+    if (numAvailable > 0)
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            // Mono tracks feed every output channel
+            buffer.copyFrom(channel, bufferToFill.startSample,
+                source, channel % source.getNumChannels(), (int)position, numAvailable);
+        }
+    }
+
+    // Silence past the end of the track
+    if (numAvailable < bufferToFill.numSamples)
+        buffer.clear(bufferToFill.startSample + numAvailable, bufferToFill.numSamples - numAvailable);
+
+    position += bufferToFill.numSamples;
+}
+
+void CachedTrackSource::setNextReadPosition(int64 newPosition)
+{
+    position = jmax((int64)0, newPosition);
+}
+
+int64 CachedTrackSource::getNextReadPosition() const
+{
+    return position;
+}
+
+int64 CachedTrackSource::getTotalLength() const
+{
+    return track->buffer.getNumSamples();
+}
+
+bool CachedTrackSource::isLooping() const
+{
+    return false;
+}
+
+//==============================================================================
+DecodedTrackCache::DecodedTrackCache()
+{
+}
+
+DecodedTrackCache::~DecodedTrackCache()
+{
+}
+
+String DecodedTrackCache::makeKey(const URL& audioURL)
+{
+    if (audioURL.isLocalFile())
+    {
+        auto file = audioURL.getLocalFile();
+        return file.getFullPathName() + "|" + String(file.getLastModificationTime().toMilliseconds());
+    }
+
+    return audioURL.toString(false);
+}
+
+void DecodedTrackCache::setByteBudget(int64 numBytes)
+{
+    const ScopedLock sl(lock);
+    byteBudget = jmax((int64)0, numBytes);
+    evictToFit(0);
+}
+
+int64 DecodedTrackCache::getByteBudget() const
+{
+    const ScopedLock sl(lock);
+    return byteBudget;
+}
+
+DecodedTrackCache::TrackPtr DecodedTrackCache::findOrDecode(const String& key,
+    AudioFormatReader& reader,
+    ProgressCallback progressCallback)
+{
+    const int64 numBytes = (int64)reader.numChannels * reader.lengthInSamples * (int64)sizeof(float);
+    std::shared_ptr<std::promise<TrackPtr>> decodePromise;
+    std::shared_future<TrackPtr> otherDecode;
+
+    {
+        const ScopedLock sl(lock);
+
+        auto found = entries.find(key);
+        if (found != entries.end())
+        {
+            // Hit: move to the front of the LRU list
+            ++hits;
+            lruOrder.splice(lruOrder.begin(), lruOrder, found->second.lruPosition);
+            return found->second.track;
+        }
+
+        auto inFlight = decodesInFlight.find(key);
+        if (inFlight != decodesInFlight.end())
+        {
+            // The other deck is decoding it right now, counted once we know how that went
+            otherDecode = inFlight->second;
+        }
+        else
+        {
+            ++misses;
+
+            // Too big for the budget (or for an AudioBuffer), the caller streams it instead
+            if (numBytes > byteBudget || reader.lengthInSamples > (int64)std::numeric_limits<int>::max())
+                return nullptr;
+
+            decodePromise = std::make_shared<std::promise<TrackPtr>>();
+            decodesInFlight[key] = decodePromise->get_future().share();
+        }
+    }
+
+    if (decodePromise == nullptr)
+    {
+        // Wait for the other decode, still giving our caller the chance to give up
+        while (otherDecode.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready)
+        {
+            if (!progressCallback(0.0))
+                return nullptr;
+        }
+
+        // Only a finished track is a hit, a failed or abandoned decode left us nothing
+        auto track = otherDecode.get();
+        {
+            const ScopedLock sl(lock);
+            if (track != nullptr)
+                ++hits;
+            else
+                ++misses;
+        }
+        return track;
+    }
+
+    auto track = decode(reader, progressCallback);
+
+    {
+        const ScopedLock sl(lock);
+        decodesInFlight.erase(key);
+
+        if (track != nullptr)
+            insert(key, track);
+    }
+
+    // Wakes anyone waiting for this track (with nullptr if the decode was abandoned)
+    decodePromise->set_value(track);
+    return track;
+}
+
+DecodedTrackCache::Stats DecodedTrackCache::getStats() const
+{
+    const ScopedLock sl(lock);
+
+    Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.numEntries = (int)entries.size();
+    stats.bytesUsed = bytesUsed;
+    stats.byteBudget = byteBudget;
+    return stats;
+}
+
+void DecodedTrackCache::clear()
+{
+    const ScopedLock sl(lock);
+
+    // Decks still playing a cached track keep their own reference to it
+    entries.clear();
+    lruOrder.clear();
+    bytesUsed = 0;
+}
+
+DecodedTrackCache::TrackPtr DecodedTrackCache::decode(AudioFormatReader& reader, ProgressCallback& progressCallback)
+{
+    auto track = std::make_shared<DecodedTrack>();
+    track->sampleRate = reader.sampleRate;
+
+    const int length = (int)reader.lengthInSamples;
+    track->buffer.setSize((int)reader.numChannels, length);
+
+    // Decode in one-second steps so progress moves and cancelling is quick
+    const int chunkSize = jmax(1, (int)reader.sampleRate);
+
+    for (int pos = 0; pos < length; pos += chunkSize)
+    {
+        const int numThisTime = jmin(chunkSize, length - pos);
+        reader.read(&track->buffer, pos, numThisTime, pos, true, true);
+
+        if (!progressCallback((double)(pos + numThisTime) / (double)length))
+            return nullptr;
+    }
+
+    return track;
+}
+
+void DecodedTrackCache::insert(const String& key, TrackPtr track)
+{
+    const int64 numBytes = track->getSizeInBytes();
+
+    // Every other track is still playing on a deck, so this one isn't kept
+    if (!evictToFit(numBytes))
+        return;
+
+    lruOrder.push_front(key);
+    entries[key] = Entry{ std::move(track), lruOrder.begin() };
+    bytesUsed += numBytes;
+}
+
+bool DecodedTrackCache::evictToFit(int64 numBytesNeeded)
+{
+    auto it = lruOrder.end();
+
+    while (bytesUsed + numBytesNeeded > byteBudget && it != lruOrder.begin())
+    {
+        --it;
+        auto entry = entries.find(*it);
+
+        // A deck still holds it, so its memory stays in use and stays counted until released
+        if (entry->second.track.use_count() > 1)
+            continue;
+
+        bytesUsed -= entry->second.track->getSizeInBytes();
+        entries.erase(entry);
+        it = lruOrder.erase(it);
+        ++evictions;
+    }
+
+    return bytesUsed + numBytesNeeded <= byteBudget;
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+
+/**
+ * A whole track decoded to floats, shared read-only between decks.
+ */
+struct DecodedTrack {
+    AudioBuffer<float> buffer;
+    double sampleRate = 0.0;
+
+    int64 getSizeInBytes() const;
+};
+
+/**
+ * Plays a DecodedTrack straight from memory: seeks and cue jumps cost nothing
+ * and no decoding or disk access happens during playback.
+ */
+class CachedTrackSource : public PositionableAudioSource {
+public:
+    explicit CachedTrackSource(std::shared_ptr<const DecodedTrack> decodedTrack);
+    ~CachedTrackSource() override;
+
+    // ==== PositionableAudioSource interface methods ====
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+    void setNextReadPosition(int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+private:
+    std::shared_ptr<const DecodedTrack> track;
+    int64 position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CachedTrackSource)
+};
+
+/**
+ * Process-wide cache of fully decoded tracks, keyed by file URL and modification
+ * time. Least recently used tracks are evicted to stay within a byte budget,
+ * but never while a deck still plays them, so the budget counts what is really held.
+ * Decks asking for the same track share one decoded copy, and a track that is
+ * already being decoded for one deck is waited for instead of decoded twice.
+ * Use through SharedResourcePointer<DecodedTrackCache>.
+ */
+class DecodedTrackCache {
+public:
+    using TrackPtr = std::shared_ptr<const DecodedTrack>;
+
+    // Called while decoding with progress 0..1, return false to abandon the decode
+    using ProgressCallback = std::function<bool(double progress)>;
+
+    struct Stats {
+        int hits = 0;
+        int misses = 0;
+        int evictions = 0;
+        int numEntries = 0;
+        int64 bytesUsed = 0;
+        int64 byteBudget = 0;
+    };
+
+    static constexpr int64 defaultByteBudget = (int64)512 * 1024 * 1024;
+
+    DecodedTrackCache();
+    ~DecodedTrackCache();
+
+    // Cache key for a file: its URL plus its modification time, so edited files are decoded again
+    static String makeKey(const URL& audioURL);
+
+    // Shrinking the budget evicts idle tracks straight away, playing ones on a later insert
+    void setByteBudget(int64 numBytes);
+    int64 getByteBudget() const;
+
+    // Returns the cached track, or decodes it from the reader on the calling thread.
+    // Returns nullptr if the track doesn't fit the budget or decoding was abandoned.
+    TrackPtr findOrDecode(const String& key, AudioFormatReader& reader, ProgressCallback progressCallback);
+
+    Stats getStats() const;
+    void clear();
+
+private:
+    struct Entry {
+        TrackPtr track;
+        std::list<String>::iterator lruPosition;
+    };
+
+    static TrackPtr decode(AudioFormatReader& reader, ProgressCallback& progressCallback);
+
+    // Both expect the lock to be held. Tracks a deck still holds are never evicted,
+    // so evictToFit returns false if the room can't be made yet.
+    void insert(const String& key, TrackPtr track);
+    bool evictToFit(int64 numBytesNeeded);
+
+    CriticalSection lock;
+    std::map<String, Entry> entries;
+    std::list<String> lruOrder;  // Most recently used first
+    std::map<String, std::shared_future<TrackPtr>> decodesInFlight;
+
+    int64 byteBudget = defaultByteBudget;
+    int64 bytesUsed = 0;
+    int hits = 0;
+    int misses = 0;
+    int evictions = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedTrackCache)
+};
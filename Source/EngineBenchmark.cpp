@@ -0,0 +1,201 @@
+#include "EngineBenchmark.h"
+#include "BandSplitEQ.h"
+#include "DeckManager.h"
+#include "DeckResampler.h"
+#include "MasterBus.h"
+#include "RealtimeAllocationGuard.h"
+#include "TimeStretchSource.h"
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+int EngineBenchmark::runFromCommandLine(const StringArray&)
+{
+    std::cout << "OtoDecks engine benchmark" << std::endl << std::endl;
+    printResamplerTimings();
+    printMixTimings();
+    printEQTimings();
+    printTimeStretchTimings();
+
+    std::cout << "Checks" << std::endl;
+    bool passed = true;
+    passed = checkLimiterCeiling() && passed;
+    passed = checkAllocationGuard() && passed;
+    std::cout << std::endl;
+
+    return passed ? 0 : 1;
+}
+
+void EngineBenchmark::printResamplerTimings()
+{
+    const double ratios[] = { 0.5, 1.0, 3.0 };
+    const DeckResampler::Mode modes[] = { DeckResampler::Mode::linear, DeckResampler::Mode::lagrange,
+                                          DeckResampler::Mode::sinc };
+
+    std::cout << "Resampler (ns per output sample, stereo, 44.1 kHz)" << std::endl;
+    std::cout << std::setw(10) << "mode";
+    for (double ratio : ratios)
+        std::cout << std::setw(10) << (String(ratio, 1) + "x").toRawUTF8();
+    std::cout << std::endl;
+
+    for (auto mode : modes)
+    {
+        std::cout << std::setw(10) << DeckResampler::getModeName(mode);
+        for (double ratio : ratios)
+            std::cout << std::setw(10) << String(DeckResampler::measureNanosecondsPerSample(mode, ratio), 1).toRawUTF8();
+        std::cout << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void EngineBenchmark::printMixTimings()
+{
+    const int deckCounts[] = { 2, 4, 8 };
+
+    // The full figure is what a mix of that many decks costs, render included; the sum is only the final pass
+    std::cout << "Deck mix (ns per output sample, stereo, 512-sample blocks)" << std::endl;
+    std::cout << std::setw(10) << "decks" << std::setw(12) << "render+sum" << std::setw(10) << "per deck"
+        << std::setw(10) << "sum only" << std::endl;
+
+    for (int numDecks : deckCounts)
+    {
+        const double nanoseconds = DeckManager::measureMixNanosecondsPerSample(numDecks);
+        std::cout << std::setw(10) << numDecks
+            << std::setw(12) << String(nanoseconds, 1).toRawUTF8()
+            << std::setw(10) << String(nanoseconds / numDecks, 1).toRawUTF8()
+            << std::setw(10) << String(DeckManager::measureSumNanosecondsPerSample(numDecks), 2).toRawUTF8() << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void EngineBenchmark::printEQTimings()
+{
+    const int channelCounts[] = { 2, BandSplitEQ::maxChannels };
+
+    std::cout << "EQ (ns per sample frame, all bands active, 512-sample blocks)" << std::endl;
+    std::cout << std::setw(10) << "channels" << std::setw(10) << "scalar" << std::setw(10) << "simd" << std::endl;
+
+    for (int numChannels : channelCounts)
+    {
+        std::cout << std::setw(10) << numChannels
+            << std::setw(10) << String(BandSplitEQ::measureNanosecondsPerSample(BandSplitEQ::Kernel::scalar, numChannels), 1).toRawUTF8()
+            << std::setw(10) << String(BandSplitEQ::measureNanosecondsPerSample(BandSplitEQ::Kernel::simd, numChannels), 1).toRawUTF8()
+            << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void EngineBenchmark::printTimeStretchTimings()
+{
+    const double tempos[] = { 0.5, 1.0, 2.0 };
+    const std::pair<TimeStretchSource::Quality, const char*> qualities[] = {
+        { TimeStretchSource::Quality::low, "low" },
+        { TimeStretchSource::Quality::medium, "medium" },
+        { TimeStretchSource::Quality::high, "high" }
+    };
+    const int blockSize = 128;
+    const double sampleRate = 44100.0;
+    const double blockMicroseconds = blockSize * 1.0e6 / sampleRate;
+
+    std::cout << "Key lock time-stretch (us per 128-sample block, stereo, 44.1 kHz)" << std::endl;
+    std::cout << std::setw(10) << "quality";
+    for (double tempo : tempos)
+        std::cout << std::setw(10) << (String(tempo, 1) + "x").toRawUTF8();
+    std::cout << std::setw(16) << "4 decks at 1x" << std::endl;
+
+    for (auto& quality : qualities)
+    {
+        std::cout << std::setw(10) << quality.second;
+        double atOriginalTempo = 0.0;
+        for (double tempo : tempos)
+        {
+            const double microseconds = TimeStretchSource::measureMicrosecondsPerBlock(quality.first, tempo, blockSize, sampleRate);
+            if (tempo == 1.0)
+                atOriginalTempo = microseconds;
+            std::cout << std::setw(10) << String(microseconds, 1).toRawUTF8();
+        }
+
+        // Share of one core that four key-locked decks would need
+        std::cout << std::setw(15) << String(400.0 * atOriginalTempo / blockMicroseconds, 1).toRawUTF8() << "%" << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+bool EngineBenchmark::checkLimiterCeiling()
+{
+    const double sampleRate = 44100.0;
+    const int blockSize = 512;
+
+    MasterBus bus;
+    bus.prepare(sampleRate, blockSize);
+    bus.setReleaseSeconds(0.001);
+    const float ceiling = Decibels::decibelsToGain(bus.getCeilingDecibels());
+
+    // Every burst starts at +6 dBFS and decays to just above the ceiling, so the needed gain
+    // rises for the whole burst; the lengths straddle the look-ahead window
+    const int window = bus.getLatencySamples() + 1;
+    const int burstLengths[] = { window / 2, window, window + 1, 2 * window, 8 * window };
+
+    AudioBuffer<float> buffer(MasterBus::numChannels, blockSize);
+    float loudest = 0.0f;
+    for (int burstLength : burstLengths)
+    {
+        // Each burst is followed by the same length of silence, plus enough to flush the delay
+        const int total = 2 * burstLength + window;
+        for (int start = 0; start < total; start += blockSize)
+        {
+            const int numSamples = jmin(blockSize, total - start);
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const int position = start + i;
+                float sample = 0.0f;
+                if (position < burstLength)
+                {
+                    const double amount = burstLength > 1 ? (double)position / (burstLength - 1) : 0.0;
+                    sample = (float)(2.0 * std::pow(0.9 / 2.0, amount)) * (position % 2 == 0 ? 1.0f : -1.0f);
+                }
+
+                for (int channel = 0; channel < MasterBus::numChannels; ++channel)
+                    buffer.setSample(channel, i, sample);
+            }
+
+            bus.process(buffer, 0, numSamples);
+            for (int channel = 0; channel < MasterBus::numChannels; ++channel)
+                loudest = jmax(loudest, buffer.getMagnitude(channel, 0, numSamples));
+        }
+    }
+
+    // Float rounding in the averaged gain is allowed for, anything more is a real overshoot
+    const bool ok = loudest <= ceiling * 1.0001f;
+    std::cout << "  limiter ceiling, decaying bursts: " << (ok ? "ok" : "FAILED")
+        << " (peak " << String(Decibels::gainToDecibels(loudest), 3).toRawUTF8()
+        << " dBFS, ceiling " << String(bus.getCeilingDecibels(), 3).toRawUTF8() << " dBFS)" << std::endl;
+    return ok;
+}
+
+bool EngineBenchmark::checkAllocationGuard()
+{
+   #if JUCE_DEBUG
+    // The per-callback buffer the guard was written to catch: HeapBlock goes through malloc, not new
+    const int violationsBefore = RealtimeAllocationGuard::getViolationCount();
+    {
+        const RealtimeAllocationGuard::ScopedNoAllocation noAllocation;
+        AudioBuffer<float> buffer(2, 512);
+        buffer.clear();
+    }
+    const int violations = RealtimeAllocationGuard::getViolationCount() - violationsBefore;
+
+    // One for allocating the buffer and one for freeing it
+    const bool ok = violations > 0;
+    std::cout << "  allocation guard, AudioBuffer in a real-time section: " << (ok ? "ok" : "FAILED")
+        << " (" << violations << " caught, each one also asserts)" << std::endl;
+    return ok;
+   #else
+    std::cout << "  allocation guard: skipped, release build" << std::endl;
+    return true;
+   #endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+ * Headless timings of the audio engine's inner loops, for comparing builds
+ * and machines without an audio device or a window.
+ * Every section runs its own test signal through one stage in isolation and
+ * prints a small table, so a change to one stage shows up on its own line.
+ * A few correctness checks run last; any failure makes the exit code 1.
+ * Runs on the calling thread, like OfflineRenderer's --render.
+ */
+class EngineBenchmark {
+public:
+    // OtoDecks --bench
+    // Prints the timings and returns the process exit code
+    static int runFromCommandLine(const StringArray& args);
+
+private:
+    // DeckResampler, in ns per output sample for every mode at a few speeds
+    static void printResamplerTimings();
+    // DeckManager rendering and summing 2, 4 and 8 decks, in ns per output sample, with the summing pass on its own
+    static void printMixTimings();
+    // BandSplitEQ, in ns per sample frame for both kernels, stereo and 8 channels
+    static void printEQTimings();
+    // TimeStretchSource, in us per 128-sample block for every quality, and what four decks would cost
+    static void printTimeStretchTimings();
+
+    // MasterBus with the fastest release, fed overshoots that decay over more than the
+    // look-ahead, must never let a sample through above the ceiling
+    static bool checkLimiterCeiling();
+    // Sizing an AudioBuffer inside a ScopedNoAllocation must trip the guard (debug builds only)
+    static bool checkAllocationGuard();
+};
@@ -0,0 +1,123 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+
+FrameScheduler::FrameScheduler()
+{
+}
+
+FrameScheduler::~FrameScheduler()
+{
+    cancelPendingUpdate();
+    setPacing(Pacing::idle);
+}
+
+void FrameScheduler::addClient(Client* client, Component& component)
+{
+    jassert(client != nullptr);
+    clients.push_back({ client, &component });
+    wake();
+}
+
+void FrameScheduler::removeClient(Client* client)
+{
+    const bool wasPacingComponent = !clients.empty() && clients.front().client == client;
+
+    clients.erase(std::remove_if(clients.begin(), clients.end(),
+        [client](const Registration& registration) { return registration.client == client; }),
+        clients.end());
+
+    // The vblank attachment may point at the component that is going away
+    if (wasPacingComponent || clients.empty())
+    {
+        cancelPendingUpdate();
+        const bool wasRunning = isRunning();
+        setPacing(Pacing::idle);
+        if (wasRunning && !clients.empty())
+            setPacing(choosePacing());
+    }
+}
+
+void FrameScheduler::wake()
+{
+    awakeUntil = Time::getMillisecondCounter() + wakeDurationMs;
+
+    // A frame may have just decided to stop
+    cancelPendingUpdate();
+    if (!isRunning() && !clients.empty())
+        setPacing(choosePacing());
+}
+
+bool FrameScheduler::isRunning() const
+{
+    return pacing != Pacing::idle;
+}
+
+int64 FrameScheduler::getFrameCount() const
+{
+    return frameCount;
+}
+
+void FrameScheduler::timerCallback()
+{
+    runFrame();
+}
+
+void FrameScheduler::handleAsyncUpdate()
+{
+    setPacing(pendingPacing);
+}
+
+void FrameScheduler::runFrame()
+{
+    ++frameCount;
+
+    // Every client gets its frame, even after one has asked for more
+    bool needsMoreFrames = false;
+    for (size_t i = 0; i < clients.size(); ++i)
+        needsMoreFrames = clients[i].client->updateFrame() || needsMoreFrames;
+
+    // Wrap-safe comparison of the millisecond counter
+    const bool stillAwake = (int32)(awakeUntil - Time::getMillisecondCounter()) > 0;
+
+    // Changed later, the vblank attachment mustn't be destroyed from its own callback
+    pendingPacing = needsMoreFrames || stillAwake ? choosePacing() : Pacing::idle;
+    if (pendingPacing != pacing)
+        triggerAsyncUpdate();
+}
+
+FrameScheduler::Pacing FrameScheduler::choosePacing() const
+{
+    if (clients.empty())
+        return Pacing::idle;
+
+    // Minimised or hidden windows get no vblank callbacks on some platforms
+    if (!clients.front().component->isShowing())
+        return Pacing::hidden;
+
+    return Process::isForegroundProcess() ? Pacing::vblank : Pacing::background;
+}
+
+void FrameScheduler::setPacing(Pacing newPacing)
+{
+    if (newPacing == pacing)
+        return;
+
+    pacing = newPacing;
+    vblankAttachment = nullptr;
+    stopTimer();
+
+    switch (pacing)
+    {
+    case Pacing::vblank:
+        vblankAttachment = std::make_unique<VBlankAttachment>(clients.front().component, [this] { runFrame(); });
+        break;
+    case Pacing::background:
+        startTimer(backgroundFrameIntervalMs);
+        break;
+    case Pacing::hidden:
+        startTimer(hiddenFrameIntervalMs);
+        break;
+    case Pacing::idle:
+        break;
+    }
+}
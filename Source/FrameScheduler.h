@@ -0,0 +1,72 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <memory>
+#include <vector>
+
+/**
+ * Drives the animated parts of the UI (playheads, spinning vinyl) from one place
+ * instead of a timer per deck. Frames follow the display's vertical blank while
+ * the window is in front, slow down while another app is in front, and slow down
+ * further while the window is minimised or hidden. Once no client needs frames
+ * the scheduler stops completely, so an idle app doesn't wake up at all until
+ * something calls wake().
+ * Message thread only. Use through SharedResourcePointer<FrameScheduler>.
+ */
+class FrameScheduler : private Timer,
+    private AsyncUpdater {
+public:
+    class Client {
+    public:
+        virtual ~Client() = default;
+
+        // Called once per frame. Invalidate only what changed since the last frame,
+        // and return true while more frames are needed
+        virtual bool updateFrame() = 0;
+    };
+
+    static constexpr int backgroundFrameIntervalMs = 66;
+    static constexpr int hiddenFrameIntervalMs = 250;
+    // Frames keep coming this long after a wake(), so a change that needs a few
+    // blocks to reach the audio thread (like pressing play) is still picked up
+    static constexpr uint32 wakeDurationMs = 500;
+
+    FrameScheduler();
+    ~FrameScheduler() override;
+
+    // The component paces the frames through its display, it must stay valid until
+    // the client is removed
+    void addClient(Client* client, Component& component);
+    void removeClient(Client* client);
+
+    // Starts frames again, call after anything that may start an animation
+    void wake();
+
+    bool isRunning() const;
+    // Frames run so far, for measuring the frame rate
+    int64 getFrameCount() const;
+
+private:
+    enum class Pacing { idle, vblank, background, hidden };
+
+    struct Registration {
+        Client* client = nullptr;
+        Component* component = nullptr;
+    };
+
+    void timerCallback() override;
+    // Applies a pacing change decided during a frame, outside the vblank callback
+    void handleAsyncUpdate() override;
+    void runFrame();
+    // Picks vblank or timer pacing from the window's state, stopping when idle
+    void setPacing(Pacing newPacing);
+    Pacing choosePacing() const;
+
+    std::vector<Registration> clients;
+    std::unique_ptr<VBlankAttachment> vblankAttachment;
+    Pacing pacing = Pacing::idle;
+    Pacing pendingPacing = Pacing::idle;
+    uint32 awakeUntil = 0;
+    int64 frameCount = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FrameScheduler)
+};
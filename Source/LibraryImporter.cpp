@@ -0,0 +1,222 @@
+#include "LibraryImporter.h"
+
+LibraryImporter::LibraryImporter(AudioFormatManager& _formatManager)
+    : formatManager(_formatManager),
+      pool(jlimit(2, 16, SystemStats::getNumCpus()))
+{
+}
+
+LibraryImporter::~LibraryImporter()
+{
+    // Running jobs stop at their next file, the pool then waits for them
+    cancel();
+}
+
+void LibraryImporter::start(const Array<File>& filesAndFolders,
+    std::shared_ptr<const KnownFiles> knownFiles,
+    BatchCallback onBatch,
+    FinishedCallback onFinished)
+{
+    cancel();
+
+    auto import = std::make_shared<Import>();
+    import->roots = filesAndFolders;
+    import->knownFiles = knownFiles != nullptr ? knownFiles : std::make_shared<const KnownFiles>();
+    import->wildcard = formatManager.getWildcardForAllFormats();
+
+    current = import;
+    batchCallback = std::move(onBatch);
+    finishedCallback = std::move(onFinished);
+
+    // One job searches, every thread probes: the last prober starts once the search is done
+    const int numProbers = pool.getNumThreads();
+    import->activeProbers = numProbers;
+
+    pool.addJob([import] { search(*import); });
+    for (int i = 0; i < numProbers; ++i)
+        pool.addJob([this, import] { probeFiles(*import); });
+
+    startTimer(batchIntervalMs);
+}
+
+void LibraryImporter::cancel()
+{
+    stopTimer();
+
+    if (current != nullptr)
+    {
+        current->cancelled = true;
+        current->filesAdded.signal();
+    }
+
+    current = nullptr;
+    batchCallback = nullptr;
+    finishedCallback = nullptr;
+}
+
+bool LibraryImporter::isImporting() const
+{
+    return current != nullptr;
+}
+
+int LibraryImporter::getNumFound() const
+{
+    return current != nullptr ? current->numFound.load() : 0;
+}
+
+int LibraryImporter::getNumDone() const
+{
+    return current != nullptr ? current->numDone.load() : 0;
+}
+
+int LibraryImporter::getNumFailed() const
+{
+    return current != nullptr ? current->numFailed.load() : 0;
+}
+
+double LibraryImporter::getProgress() const
+{
+    if (current == nullptr || !current->searchFinished || current->numFound == 0)
+        return 0.0;
+
+    return (double)current->numDone / (double)current->numFound;
+}
+
+void LibraryImporter::timerCallback()
+{
+    if (current == nullptr)
+    {
+        stopTimer();
+        return;
+    }
+
+    // Checked first: once no prober is left, nothing is added after the swap below
+    const bool allProbed = current->activeProbers == 0;
+
+    std::vector<TrackLibrary::Track> batch;
+    {
+        const ScopedLock sl(current->lock);
+        batch.swap(current->pending);
+    }
+
+    if (!batch.empty() && batchCallback != nullptr)
+        batchCallback(std::move(batch));
+
+    // The batch callback may have started another import
+    if (allProbed && current != nullptr && current->activeProbers == 0)
+    {
+        auto onFinished = std::move(finishedCallback);
+        cancel();
+        if (onFinished != nullptr)
+            onFinished();
+    }
+}
+
+void LibraryImporter::search(Import& import)
+{
+    auto addFile = [&import](const File& file)
+    {
+        {
+            const ScopedLock sl(import.lock);
+            import.files.push_back(file);
+        }
+        ++import.numFound;
+        import.filesAdded.signal();
+    };
+
+    for (auto& root : import.roots)
+    {
+        if (import.cancelled)
+            break;
+
+        if (root.isDirectory())
+        {
+            for (const auto& entry : RangedDirectoryIterator(root, true, import.wildcard, File::findFiles))
+            {
+                if (import.cancelled)
+                    break;
+
+                if (!entry.isHidden())
+                    addFile(entry.getFile());
+            }
+        }
+        else if (root.existsAsFile())
+        {
+            addFile(root);
+        }
+    }
+
+    {
+        const ScopedLock sl(import.lock);
+        import.searchFinished = true;
+    }
+    import.filesAdded.signal();
+}
+
+void LibraryImporter::probeFiles(Import& import)
+{
+    while (!import.cancelled)
+    {
+        File file;
+        bool haveFile = false;
+        bool searchFinished = false;
+        {
+            const ScopedLock sl(import.lock);
+            searchFinished = import.searchFinished;
+            if (import.nextFile < import.files.size())
+            {
+                file = import.files[import.nextFile++];
+                haveFile = true;
+            }
+        }
+
+        if (!haveFile)
+        {
+            if (searchFinished)
+                break;
+
+            // The search is still running, wait for it to find more
+            import.filesAdded.wait(20);
+            continue;
+        }
+
+        // Unchanged files keep their library entry and are never opened
+        const auto known = import.knownFiles->find(file.getFullPathName());
+        const bool unchanged = known != import.knownFiles->end()
+            && known->second == file.getLastModificationTime().toMilliseconds();
+
+        TrackLibrary::Track track;
+        if (!unchanged)
+        {
+            if (probe(file, track))
+            {
+                const ScopedLock sl(import.lock);
+                import.pending.push_back(std::move(track));
+            }
+            else
+            {
+                ++import.numFailed;
+            }
+        }
+
+        ++import.numDone;
+    }
+
+    --import.activeProbers;
+}
+
+bool LibraryImporter::probe(const File& file, TrackLibrary::Track& track)
+{
+    // Only the header is read for most formats
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->sampleRate <= 0.0)
+        return false;
+
+    track.file = file;
+    track.title = file.getFileNameWithoutExtension();
+    track.artist = "Unknown Artist";
+    track.duration = (double)reader->lengthInSamples / reader->sampleRate;
+    track.modificationTime = file.getLastModificationTime().toMilliseconds();
+    track.fileSize = file.getSize();
+    return true;
+}
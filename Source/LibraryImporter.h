@@ -0,0 +1,88 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrackLibrary.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Imports files and whole folders into the track library without blocking
+ * the message thread. Folders are searched recursively for every format the
+ * format manager knows, on a worker thread, while the files found so far are
+ * already being probed for their length by the other workers of a pool sized
+ * to the machine. Tracks are handed back on the message thread in batches a
+ * few times a second, so a large crate costs one table update per batch
+ * rather than one per file. Files already in the library, unchanged since,
+ * are skipped without being opened.
+ * One import runs at a time; starting another cancels the running one.
+ */
+class LibraryImporter : private Timer {
+public:
+    // Path to modification time (in milliseconds) of every track already in the library
+    using KnownFiles = std::unordered_map<String, int64>;
+
+    // Called on the message thread with the tracks read since the last batch
+    using BatchCallback = std::function<void(std::vector<TrackLibrary::Track> tracks)>;
+    // Called on the message thread once every file has been looked at
+    using FinishedCallback = std::function<void()>;
+
+    static constexpr int batchIntervalMs = 250;
+
+    explicit LibraryImporter(AudioFormatManager& formatManager);
+    ~LibraryImporter() override;
+
+    void start(const Array<File>& filesAndFolders,
+        std::shared_ptr<const KnownFiles> knownFiles,
+        BatchCallback onBatch,
+        FinishedCallback onFinished);
+    // Drops whatever hasn't been delivered yet, onFinished isn't called
+    void cancel();
+
+    bool isImporting() const;
+    // Audio files found so far, and how many of them are done (read, skipped or failed)
+    int getNumFound() const;
+    int getNumDone() const;
+    int getNumFailed() const;
+    // 0..1, only meaningful once the folders have been searched
+    double getProgress() const;
+
+private:
+    // Shared by the jobs of one import, so a cancelled import can finish in the background
+    struct Import {
+        Array<File> roots;
+        std::shared_ptr<const KnownFiles> knownFiles;
+        String wildcard;
+
+        CriticalSection lock;
+        std::vector<File> files;              // Found by the search, in order
+        size_t nextFile = 0;                  // Next one to probe
+        std::vector<TrackLibrary::Track> pending;
+        WaitableEvent filesAdded;
+
+        std::atomic<bool> searchFinished{ false };
+        std::atomic<bool> cancelled{ false };
+        std::atomic<int> numFound{ 0 };
+        std::atomic<int> numDone{ 0 };
+        std::atomic<int> numFailed{ 0 };
+        std::atomic<int> activeProbers{ 0 };
+    };
+
+    void timerCallback() override;
+
+    static void search(Import& import);
+    void probeFiles(Import& import);
+    // Reads what the playlist shows, false if the file isn't a readable audio file
+    bool probe(const File& file, TrackLibrary::Track& track);
+
+    AudioFormatManager& formatManager;
+    std::shared_ptr<Import> current;
+    BatchCallback batchCallback;
+    FinishedCallback finishedCallback;
+
+    // Declared last so it is destroyed first, waiting for running jobs
+    ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryImporter)
+};
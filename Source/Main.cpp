@@ -10,6 +10,8 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "MainComponent.h"
+#include "EngineBenchmark.h"
+#include "OfflineRenderer.h"
 
 //==============================================================================
 class OtoDecksApplication : public JUCEApplication
@@ -26,6 +28,22 @@ public:
     {
         // This method is where you should put your application's initialisation code..
 
+        // Headless bounce, no window and no audio device
+        const StringArray args = StringArray::fromTokens(commandLine, true);
+        if (args[0] == "--render")
+        {
+            setApplicationReturnValue(OfflineRenderer::runFromCommandLine(args));
+            quit();
+            return;
+        }
+
+        if (args[0] == "--bench")
+        {
+            setApplicationReturnValue(EngineBenchmark::runFromCommandLine(args));
+            quit();
+            return;
+        }
+
         mainWindow.reset(new MainWindow(getApplicationName()));
     }
 
@@ -24,13 +24,7 @@ MainComponent::MainComponent() : AudioAppComponent::AudioAppComponent(), Slider:
         // Specify the number of input and output channels that we want to open
         setAudioChannels(0, 2, nullptr);
     }
-    // Set deck IDs for visual distinction
-    deck1.setDeckId(0);  // Left deck
-    deck2.setDeckId(1);  // Right deck
-
     // Add components to the UI
-    addAndMakeVisible(deck1);
-    addAndMakeVisible(deck2);
     addAndMakeVisible(playlistComponent);
     addAndMakeVisible(crossfader);
 
@@ -40,6 +34,7 @@ MainComponent::MainComponent() : AudioAppComponent::AudioAppComponent(), Slider:
     crossfader.setRange(0.0, 1.0);  // 0 = full left deck, 1 = full right deck
     crossfader.setValue(0.5);
     crossfader.addListener(this);
+    applyCrossfader();
     crossfader.setLookAndFeel(&crossfaderLookAndFeel);
     crossfader.setName("crossfader");
     addAndMakeVisible(crossfaderLabel);
@@ -48,14 +43,54 @@ MainComponent::MainComponent() : AudioAppComponent::AudioAppComponent(), Slider:
     crossfaderLabel.setJustificationType(Justification::centred);
     crossfaderLabel.setColour(Label::textColourId, Colours::white.withAlpha(0.7f));
 
+    // Curve selector, item IDs follow Crossfader::Curve
+    addAndMakeVisible(crossfaderCurveSelector);
+    crossfaderCurveSelector.addItem("Power", (int)Crossfader::Curve::constantPower + 1);
+    crossfaderCurveSelector.addItem("Linear", (int)Crossfader::Curve::linear + 1);
+    crossfaderCurveSelector.addItem("Cut", (int)Crossfader::Curve::cut + 1);
+    crossfaderCurveSelector.setSelectedId((int)deckManager.getCrossfader().getCurve() + 1, dontSendNotification);
+    crossfaderCurveSelector.addListener(this);
+    crossfaderCurveSelector.setColour(ComboBox::backgroundColourId, Colour(0xFF2d3035));
+    crossfaderCurveSelector.setColour(ComboBox::outlineColourId, Colour(0xFF3d4148));
+    crossfaderCurveSelector.setColour(ComboBox::textColourId, Colours::white);
+
+    // Buttons to grow or shrink the set, to render the decks on several cores and to record the mix
+    parallelButton.setClickingTogglesState(true);
+    for (auto* button : { &addDeckButton, &removeDeckButton, &parallelButton, &recordButton })
+    {
+        addAndMakeVisible(button);
+        button->addListener(this);
+        button->setLookAndFeel(&crossfaderLookAndFeel);
+        button->setColour(TextButton::buttonColourId, Colour(0xFF2d3035));
+        button->setColour(TextButton::textColourOffId, Colours::white);
+    }
+    recordButton.setColour(TextButton::buttonOnColourId, Colour(0xFFb03030));
+
+    addAndMakeVisible(renderStatsLabel);
+    renderStatsLabel.setFont(Font(12.0f));
+    renderStatsLabel.setColour(Label::textColourId, Colours::white.withAlpha(0.5f));
+
+    // The readout runs while anything is animating, playing or recording, and sleeps with the UI
+    frameScheduler->addClient(this, *this);
+
+    // Decks get their IDs (and so their letter and tint) in the order they are added
+    for (int i = 0; i < numStartupDecks; ++i)
+        addDeck();
+
     // Register basic audio formats for playback
     formatManager.registerBasicFormats();
 }
 
 MainComponent::~MainComponent()
 {
+    frameScheduler->removeClient(this);
+
     // Clean up look and feel
     crossfader.setLookAndFeel(nullptr);
+    addDeckButton.setLookAndFeel(nullptr);
+    removeDeckButton.setLookAndFeel(nullptr);
+    parallelButton.setLookAndFeel(nullptr);
+    recordButton.setLookAndFeel(nullptr);
     // This shuts down the audio device and clears the audio source.
     shutdownAudio();
 }
@@ -63,19 +98,22 @@ MainComponent::~MainComponent()
 //==============================================================================
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    // Add both deck players to the mixer
-    mixerAudioSource.addInputSource(&player1, false);
-    mixerAudioSource.addInputSource(&player2, false);
-    mixerAudioSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // Prepares every deck, and any deck added later as it is created
+    deckManager.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    masterBus.prepare(sampleRate, samplesPerBlockExpected);
+    mixRecorder.prepare(sampleRate);
 }
 void MainComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
 {
-    // play audio loaded in the transport source
-    mixerAudioSource.getNextAudioBlock(bufferToFill);
-
-}
+    // Render all decks and sum them into the output
+    deckManager.getNextAudioBlock(bufferToFill);
 
+    // Limit and meter what goes to the device
+    masterBus.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
 
+    // Only a copy into the recorder's ring, the disk is written on its own threads
+    mixRecorder.pushBlock(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+}
 
 void MainComponent::releaseResources()
 {
@@ -83,41 +121,42 @@ void MainComponent::releaseResources()
     // restarted due to a setting change.
 
     // For more details, see the help for AudioProcessor::releaseResources()
-    mixerAudioSource.removeAllInputs();
-    mixerAudioSource.releaseResources();
-    player1.releaseResources();
-    player2.releaseResources();
+    deckManager.releaseResources();
+    masterBus.releaseResources();
 }
 
 //==============================================================================
 void MainComponent::paint(Graphics& g)
 {
-    // Draw dark gradient background
-    ColourGradient gradient(Colour(0xFF252525), 0, 0,
-                           Colour(0xFF101010), 0, getHeight(), false);
-    g.setGradientFill(gradient);
-    g.fillAll();
-
-    // Add subtle texture with horizontal lines
-    g.setOpacity(0.05f);
-    for (int y = 0; y < getHeight(); y += 4) {
-        g.setColour(Colours::white.withAlpha(0.1f));
-        g.drawHorizontalLine(y, 0, getWidth());
-    }
+    // Dark gradient background with a subtle line texture, drawn once per size
+    backgroundLayer.draw(g, getWidth(), getHeight(), { Colour(0xFF252525), Colour(0xFF101010) });
 
-    // Borders and dividers
+    // Borders and dividers, the decks sit in rows of two
+    const int deckAreaHeight = getDeckAreaHeight();
     g.setColour(Colours::white.withAlpha(0.2f));
-    g.drawVerticalLine(getWidth() / 2, 0, deck1.getBottom());
+    g.drawVerticalLine(getWidth() / 2, 0, deckAreaHeight);
     g.setColour(Colours::white.withAlpha(0.1f));
-    g.drawHorizontalLine(deck1.getBottom(), 0, getWidth());
+    for (auto* deck : deckGUIs)
+        g.drawHorizontalLine(deck->getBottom(), 0, getWidth());
+    g.drawHorizontalLine(deckAreaHeight, 0, getWidth());
     g.drawHorizontalLine(crossfader.getBottom() + 5, 0, getWidth());
 }
+
+int MainComponent::getDeckAreaHeight() const
+{
+    return getHeight() / 4 * 3 - 100;
+}
 void MainComponent::resized()
 {
-    // Position the decks side by side at the top
-    int deckHeight = getHeight() / 4 * 3 - 100;
-    deck1.setBounds(0, 0, getWidth() / 2, deckHeight);
-    deck2.setBounds(getWidth() / 2, 0, getWidth() / 2, deckHeight);
+    // Position the decks at the top, left and right of the crossfader in rows of two
+    int deckHeight = getDeckAreaHeight();
+    int numRows = jmax(1, (deckGUIs.size() + 1) / 2);
+    for (int i = 0; i < deckGUIs.size(); ++i)
+    {
+        int rowTop = deckHeight * (i / 2) / numRows;
+        int rowBottom = deckHeight * (i / 2 + 1) / numRows;
+        deckGUIs[i]->setBounds((i % 2) * getWidth() / 2, rowTop, getWidth() / 2, rowBottom - rowTop);
+    }
 
     // Position crossfader centered below the decks
     int labelHeight = 20;
@@ -130,6 +169,17 @@ void MainComponent::resized()
     crossfaderLabel.setBounds(crossfaderX, crossfaderY, crossfaderWidth, labelHeight);
     crossfader.setBounds(crossfaderX, crossfaderY + labelHeight, crossfaderWidth, crossfaderHeight);
 
+    // Curve selector and deck buttons to the left of the crossfader
+    int buttonWidth = 80;
+    crossfaderCurveSelector.setBounds(jmax(5, crossfaderX - 3 * (buttonWidth + 10) - 10), crossfaderY + 5, buttonWidth + 10, labelHeight + crossfaderHeight - 5);
+    removeDeckButton.setBounds(crossfaderX - 2 * (buttonWidth + 10), crossfaderY + 5, buttonWidth, labelHeight + crossfaderHeight - 5);
+    addDeckButton.setBounds(crossfaderX - (buttonWidth + 10), crossfaderY + 5, buttonWidth, labelHeight + crossfaderHeight - 5);
+
+    // Render mode and timing to the right of it
+    parallelButton.setBounds(crossfader.getRight() + 10, crossfaderY + 5, buttonWidth + 10, labelHeight + crossfaderHeight - 5);
+    recordButton.setBounds(parallelButton.getRight() + 10, crossfaderY + 5, buttonWidth, labelHeight + crossfaderHeight - 5);
+    renderStatsLabel.setBounds(recordButton.getRight() + 5, crossfaderY + 5, getWidth() - recordButton.getRight() - 10, labelHeight + crossfaderHeight - 5);
+
     // Position playlist after crossfader
     int playlistY = crossfader.getBottom() + 5;
     int playlistHeight = getHeight() - playlistY;
@@ -140,14 +190,163 @@ void MainComponent::sliderValueChanged(Slider* slider)
 {
     if (slider == &crossfader)
     {
-        double value = crossfader.getValue();
+        applyCrossfader();
+    }
+}
+
+void MainComponent::buttonClicked(Button* button)
+{
+    if (button == &addDeckButton)
+    {
+        addDeck();
+    }
+    else if (button == &removeDeckButton)
+    {
+        removeLastDeck();
+    }
+    else if (button == &parallelButton)
+    {
+        // Stays serial on a single core, the button shows what actually happened
+        deckManager.setParallelRendering(parallelButton.getToggleState());
+        parallelButton.setToggleState(deckManager.isParallelRenderingEnabled(), dontSendNotification);
+    }
+    else if (button == &recordButton)
+    {
+        toggleRecording();
+    }
 
-        // Calculate gains for each deck based on crossfader position
-        double gain1 = 1.0 - value; // Left deck (full at 0, silent at 1)
-        double gain2 = value;       // Right deck (silent at 0, full at 1)
+    // Every button changes what the readout shows, so it runs again
+    frameScheduler->wake();
+}
+
+void MainComponent::comboBoxChanged(ComboBox* comboBox)
+{
+    if (comboBox == &crossfaderCurveSelector)
+    {
+        // Faded in on the audio thread, so switching mid-mix doesn't click
+        deckManager.getCrossfader().setCurve((Crossfader::Curve)(crossfaderCurveSelector.getSelectedId() - 1));
+    }
+}
 
-        // Set gains
-        player1.setGain(gain1);
-        player2.setGain(gain2);
+void MainComponent::timerCallback()
+{
+    double vinylMicroseconds = 0.0;
+    double backgroundMicroseconds = backgroundLayer.getAveragePaintMicroseconds();
+    double fullBackgroundMicroseconds = backgroundLayer.getLastRenderMicroseconds();
+    for (auto* deckGUI : deckGUIs)
+    {
+        vinylMicroseconds += deckGUI->getVinylPaintMicroseconds();
+        backgroundMicroseconds += deckGUI->getBackgroundLayer().getAveragePaintMicroseconds();
+        fullBackgroundMicroseconds += deckGUI->getBackgroundLayer().getLastRenderMicroseconds();
     }
+
+    const uint32 now = Time::getMillisecondCounter();
+    const int64 frameCount = frameScheduler->getFrameCount();
+    const double framesPerSecond = (frameCount - lastFrameCount) * 1000.0 / jmax((uint32)1, now - lastStatsTime);
+    lastFrameCount = frameCount;
+    lastStatsTime = now;
+
+    renderStatsLabel.setText("RENDER " + String(deckManager.getRenderMicroseconds(), 0) + " us  MIX "
+        + String(deckManager.getMixMicroseconds(), 1) + " us  MASTER "
+        + String(masterBus.getAverageProcessMicroseconds(), 1) + " us (+"
+        + String(masterBus.getLatencySeconds() * 1000.0, 1) + " ms look-ahead)\n"
+        + "TP " + String(masterBus.getTruePeakDecibels(), 1) + " dB  LUFS "
+        + String(masterBus.getShortTermLoudness(), 1) + "  GR "
+        + String(masterBus.getGainReductionDecibels(), 1) + " dB  VINYL "
+        + String(vinylMicroseconds, 0) + " us  UI "
+        + String(framesPerSecond, 0) + " fps  BG "
+        + String(backgroundMicroseconds, 0) + " us (full " + String(fullBackgroundMicroseconds, 0) + " us)"
+        + (mixRecorder.getOverflowCount() > 0 ? "  REC LOST " + String(mixRecorder.getOverflowCount()) : String()),
+        dontSendNotification);
+
+    if (mixRecorder.isRecording())
+    {
+        const int seconds = (int)mixRecorder.getRecordedSeconds();
+        recordButton.setButtonText("REC " + String::formatted("%d:%02d", seconds / 60, seconds % 60));
+        return;
+    }
+
+    // Playing decks keep the UI awake, and the meters fall to silence a few seconds after the last one stops
+    if (!frameScheduler->isRunning() && masterBus.getTruePeakDecibels() <= -100.0f
+        && masterBus.getShortTermLoudness() <= -100.0f)
+        stopTimer();
+}
+
+bool MainComponent::updateFrame()
+{
+    if (!isTimerRunning())
+        startTimer(statsIntervalMs);
+
+    return false;
+}
+
+void MainComponent::toggleRecording()
+{
+    if (mixRecorder.isRecording())
+    {
+        mixRecorder.stop();
+        recordButton.setButtonText("REC");
+        recordButton.setToggleState(false, dontSendNotification);
+        return;
+    }
+
+    const File file = File::getSpecialLocation(File::userMusicDirectory)
+        .getNonexistentChildFile("OtoDecks mix " + Time::getCurrentTime().formatted("%Y-%m-%d %H%M"), ".wav");
+
+    String error;
+    if (!mixRecorder.start(file, error))
+    {
+        DBG("MainComponent::toggleRecording " + error);
+        return;
+    }
+
+    recordButton.setToggleState(true, dontSendNotification);
+}
+
+void MainComponent::addDeck()
+{
+    DJAudioPlayer* player = deckManager.addDeck();
+    if (player == nullptr)
+        return;
+
+    DeckGUI* deck = deckGUIs.add(new DeckGUI(player, trackLoader));
+    deck->setDeckId(deckGUIs.size() - 1);
+    addAndMakeVisible(deck);
+
+    // Decks A, C... are on the left of the crossfader, B, D... on the right
+    deckManager.setCrossfaderAssignment(player, deck->getDeckId() % 2 == 0 ? Crossfader::Assignment::left
+                                                                           : Crossfader::Assignment::right);
+
+    decksChanged();
+}
+
+void MainComponent::removeLastDeck()
+{
+    // Always keep one deck
+    if (deckGUIs.size() <= 1)
+        return;
+
+    // The GUI goes first, it cancels its load and stops talking to the player
+    DJAudioPlayer* player = deckManager.getDeck(deckGUIs.size() - 1);
+    deckGUIs.removeLast();
+    deckManager.removeDeck(player);
+
+    decksChanged();
+}
+
+void MainComponent::decksChanged()
+{
+    playlistComponent.setDecks(Array<DeckGUI*>(deckGUIs.begin(), deckGUIs.size()));
+
+    addDeckButton.setEnabled(deckGUIs.size() < DeckManager::maxDecks);
+    removeDeckButton.setEnabled(deckGUIs.size() > 1);
+
+    resized();
+    repaint();
+}
+
+void MainComponent::applyCrossfader()
+{
+    // The curve and the smoothing are applied in the mix, each deck's volume knob stays separate
+    deckManager.getCrossfader().setPosition((float)crossfader.getValue());
 }
\ No newline at end of file
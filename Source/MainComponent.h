@@ -3,15 +3,25 @@ using namespace std;
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DJAudioPlayer.h"
 #include "DeckGUI.h"
+#include "BackgroundLayer.h"
+#include "DeckManager.h"
+#include "MasterBus.h"
+#include "MixRecorder.h"
 #include "PlaylistComponent.h"
 #include "DeckGUILookAndFeel.h"
+#include "DeckStreamingService.h"
+#include "TrackLoader.h"
 
 /**
  * Main application component that contains and manages all UI elements
  * and the audio processing chain. Acts as the central hub for the DJ app.
  */
 class MainComponent : public AudioAppComponent,
-  public Slider::Listener
+  public Slider::Listener,
+  public Button::Listener,
+  public ComboBox::Listener,
+  private Timer,
+  private FrameScheduler::Client
 {
 public:
   MainComponent();
@@ -29,28 +39,74 @@ public:
   // Handle crossfader movements
   void sliderValueChanged(Slider* slider) override;
 
+  // Handle adding and removing decks
+  void buttonClicked(Button* button) override;
+
+  // Handle crossfader curve changes
+  void comboBoxChanged(ComboBox* comboBox) override;
+
 private:
+  static constexpr int numStartupDecks = 2;
+
+  // Adds a deck and its GUI at the end, or removes the last one
+  void addDeck();
+  void removeLastDeck();
+  // Updates the playlist, crossfader and layout after the deck list changed
+  void decksChanged();
+  // Sends the slider position to the mixer's crossfader
+  void applyCrossfader();
+  // Starts recording the master output to a new file in the music folder, or stops it
+  void toggleRecording();
+  int getDeckAreaHeight() const;
+  // Refreshes the render timing readout and the recording time, stopping once nothing plays or records
+  void timerCallback() override;
+  // Restarts the readout whenever the UI wakes up, needs no frames itself
+  bool updateFrame() override;
+  static constexpr int statsIntervalMs = 500;
+
   // Audio format handling
   AudioFormatManager formatManager;
-  AudioThumbnailCache thumbCache{ 100 };
 
-  // Crossfader between decks
+  // Background read-ahead shared by all decks, one worker thread per deck of a four-deck set
+  DeckStreamingService streamingService{ 4 };
+
+  // Opens and pre-decodes tracks for the decks and the playlist off the message thread
+  TrackLoader trackLoader{ formatManager, streamingService };
+
+  // Crossfader between decks and its curve
   Slider crossfader;
+  ComboBox crossfaderCurveSelector;
   DeckGUILookAndFeel crossfaderLookAndFeel;
 
-  // First deck (left)
-  DJAudioPlayer player1{ formatManager };
-  DeckGUI deck1{ &player1, formatManager, thumbCache };
+  // All deck players and the mix of them
+  DeckManager deckManager;
+
+  // Limiter and meters on the final mix
+  MasterBus masterBus;
+
+  // Records the master output to disk
+  MixRecorder mixRecorder;
+  TextButton recordButton{ "REC" };
+
+  // Window background, drawn again only when the window is resized
+  BackgroundLayer backgroundLayer;
+
+  // One GUI per deck, in the same order as the deck manager's list
+  OwnedArray<DeckGUI> deckGUIs;
+  TextButton addDeckButton{ "+ DECK" };
+  TextButton removeDeckButton{ "- DECK" };
 
-  // Second deck (right)
-  DJAudioPlayer player2{ formatManager };
-  DeckGUI deck2{ &player2, formatManager, thumbCache };
+  // Parallel deck rendering, its cost per block and the master meters
+  TextButton parallelButton{ "PARALLEL" };
+  Label renderStatsLabel;
+  // UI frames drawn since the last stats update, 0 while every deck is idle
+  SharedResourcePointer<FrameScheduler> frameScheduler;
+  int64 lastFrameCount = 0;
+  uint32 lastStatsTime = 0;
 
-  // Audio mixer to combine both decks
-  MixerAudioSource mixerAudioSource;
   Label crossfaderLabel;
-  // Playlist component with references to both decks
-  PlaylistComponent playlistComponent{ &player1, &player2, &deck1, &deck2 };
+  // Playlist component, loads into any of the decks
+  PlaylistComponent playlistComponent{ formatManager };
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "MasterBus.h"
+#include <cstring>
+
+void MasterBus::Biquad::process(const float* input, float* output, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float x = input[i];
+        const float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        output[i] = y;
+    }
+}
+
+MasterBus::MasterBus()
+{
+    for (auto& level : rms)
+        level = 0.0f;
+}
+
+MasterBus::~MasterBus()
+{
+}
+
+void MasterBus::prepare(double sampleRate, int maximumBlockSize)
+{
+    currentSampleRate = sampleRate;
+    maxBlockSize = jmax(1, maximumBlockSize);
+
+    // ==== Limiter ====
+    windowLength = jmax(2, roundToInt(lookAheadSeconds * sampleRate));
+    const int delayLength = windowLength - 1;
+    delayStorage.calloc((size_t)(numChannels * (delayLength + maxBlockSize)));
+    for (int channel = 0; channel < numChannels; ++channel)
+        delayLines[channel] = delayStorage + channel * (delayLength + maxBlockSize);
+
+    peakScratch.calloc((size_t)maxBlockSize);
+    gainScratch.calloc((size_t)maxBlockSize);
+    minimumTimes.calloc((size_t)windowLength);
+    minimumValues.calloc((size_t)windowLength);
+    averageHistory.calloc((size_t)windowLength);
+    FloatVectorOperations::fill(averageHistory, 1.0f, windowLength);
+    averageSum = windowLength;
+    averagePosition = 0;
+    releasedGain = 1.0f;
+    minimumHead = 0;
+    minimumCount = 0;
+    sampleCounter = 0;
+
+    // ==== True peak ====
+    // Windowed sinc, phase p interpolates p/4 of a sample after the sample six taps back.
+    // Phase 0 lands on that sample exactly, so sample peaks are always included.
+    const int simdWidth = (int)Vec::SIMDNumElements;
+    phaseStorage.calloc((size_t)(tapsPerPhase * simdWidth + simdWidth));
+    phaseCoefficients = Vec::getNextSIMDAlignedPtr(phaseStorage.get());
+    for (int phase = 0; phase < oversampling; ++phase)
+    {
+        double sum = 0.0;
+        for (int tap = 0; tap < tapsPerPhase; ++tap)
+        {
+            const double distance = tap - tapsPerPhase / 2 + (double)phase / oversampling;
+            const double x = MathConstants<double>::pi * distance;
+            const double sinc = distance == 0.0 ? 1.0 : std::sin(x) / x;
+            const double window = 0.5 + 0.5 * std::cos(MathConstants<double>::pi * distance / (tapsPerPhase / 2 + 0.5));
+            phaseCoefficients[tap * simdWidth + phase] = (float)(sinc * window);
+            sum += sinc * window;
+        }
+
+        for (int tap = 0; tap < tapsPerPhase; ++tap)
+            phaseCoefficients[tap * simdWidth + phase] = (float)(phaseCoefficients[tap * simdWidth + phase] / sum);
+    }
+
+    peakHistoryStorage.calloc((size_t)(numChannels * (tapsPerPhase - 1 + maxBlockSize)));
+    for (int channel = 0; channel < numChannels; ++channel)
+        peakHistory[channel] = peakHistoryStorage + channel * (tapsPerPhase - 1 + maxBlockSize);
+
+    // ==== Loudness ====
+    // K-weighting from BS.1770, recomputed for the device rate (as in libebur128)
+    {
+        const double f0 = 1681.974450955533;
+        const double gainDb = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+
+        Biquad shelf;
+        shelf.b0 = (float)((vh + vb * k / q + k * k) / a0);
+        shelf.b1 = (float)(2.0 * (k * k - vh) / a0);
+        shelf.b2 = (float)((vh - vb * k / q + k * k) / a0);
+        shelf.a1 = (float)(2.0 * (k * k - 1.0) / a0);
+        shelf.a2 = (float)((1.0 - k / q + k * k) / a0);
+
+        for (auto& filter : shelfFilters)
+            filter = shelf;
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+
+        Biquad highPass;
+        highPass.b0 = 1.0f;
+        highPass.b1 = -2.0f;
+        highPass.b2 = 1.0f;
+        highPass.a1 = (float)(2.0 * (k * k - 1.0) / a0);
+        highPass.a2 = (float)((1.0 - k / q + k * k) / a0);
+
+        for (auto& filter : highPassFilters)
+            filter = highPass;
+    }
+
+    weightedScratch.calloc((size_t)(numChannels * maxBlockSize));
+    binLength = jmax(1, roundToInt(0.1 * sampleRate));
+    binEnergy = 0.0;
+    binPosition = 0;
+    numBinsFilled = 0;
+    nextBin = 0;
+    for (auto& meanSquare : meanSquares)
+        meanSquare = 0.0;
+}
+
+void MasterBus::releaseResources()
+{
+    delayStorage.free();
+    peakScratch.free();
+    gainScratch.free();
+    minimumTimes.free();
+    minimumValues.free();
+    averageHistory.free();
+    phaseStorage.free();
+    peakHistoryStorage.free();
+    weightedScratch.free();
+    windowLength = 0;
+}
+
+void MasterBus::setCeilingDecibels(float decibels)
+{
+    ceiling = Decibels::decibelsToGain(jmin(0.0f, decibels));
+}
+
+float MasterBus::getCeilingDecibels() const
+{
+    return Decibels::gainToDecibels(ceiling.load());
+}
+
+void MasterBus::setReleaseSeconds(double seconds)
+{
+    releaseSeconds = jlimit(0.001, 5.0, seconds);
+}
+
+void MasterBus::setLimiterEnabled(bool shouldLimit)
+{
+    limiterEnabled = shouldLimit;
+}
+
+bool MasterBus::isLimiterEnabled() const
+{
+    return limiterEnabled;
+}
+
+int MasterBus::getLatencySamples() const
+{
+    return jmax(0, windowLength - 1);
+}
+
+double MasterBus::getLatencySeconds() const
+{
+    return currentSampleRate > 0.0 ? getLatencySamples() / currentSampleRate : 0.0;
+}
+
+double MasterBus::getAverageProcessMicroseconds() const
+{
+    return averageMicroseconds;
+}
+
+float MasterBus::getTruePeakDecibels() const
+{
+    return Decibels::gainToDecibels(truePeak.load(), -100.0f);
+}
+
+float MasterBus::getTruePeakHoldDecibels() const
+{
+    return Decibels::gainToDecibels(truePeakHold.load(), -100.0f);
+}
+
+void MasterBus::resetTruePeakHold()
+{
+    truePeakHold = 0.0f;
+}
+
+float MasterBus::getRmsDecibels(int channel) const
+{
+    return Decibels::gainToDecibels(rms[jlimit(0, numChannels - 1, channel)].load(), -100.0f);
+}
+
+float MasterBus::getMomentaryLoudness() const
+{
+    return momentaryLoudness;
+}
+
+float MasterBus::getShortTermLoudness() const
+{
+    return shortTermLoudness;
+}
+
+float MasterBus::getGainReductionDecibels() const
+{
+    return Decibels::gainToDecibels(gainReduction.load(), -100.0f);
+}
+
+void MasterBus::process(AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    // Not prepared yet
+    if (windowLength == 0)
+        return;
+
+    ScopedNoDenormals noDenormals;
+    const auto startTicks = Time::getHighResolutionTicks();
+    const int channels = jmin(buffer.getNumChannels(), (int)numChannels);
+    blockTruePeak = 0.0f;
+
+    // Hosts may hand us a bigger block than announced, so work in prepared-size chunks
+    for (int offset = 0; offset < numSamples; offset += maxBlockSize)
+        processChunk(buffer, startSample + offset, jmin(maxBlockSize, numSamples - offset), channels);
+
+    truePeak = blockTruePeak;
+    if (blockTruePeak > truePeakHold)
+        truePeakHold = blockTruePeak;
+
+    const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1.0e6;
+    averageMicroseconds = averageMicroseconds + 0.05 * (elapsed - averageMicroseconds);
+}
+
+void MasterBus::processChunk(AudioBuffer<float>& buffer, int startSample, int numSamples, int channels)
+{
+    if (channels == 0 || numSamples <= 0)
+        return;
+
+    // Loudest channel at every sample, both channels get the same gain so the image doesn't shift
+    FloatVectorOperations::abs(peakScratch, buffer.getReadPointer(0, startSample), numSamples);
+    for (int channel = 1; channel < channels; ++channel)
+    {
+        FloatVectorOperations::abs(gainScratch, buffer.getReadPointer(channel, startSample), numSamples);
+        FloatVectorOperations::max(peakScratch, peakScratch, gainScratch, numSamples);
+    }
+
+    computeLimiterGains(numSamples);
+
+    // Play the look-ahead-delayed audio through the gains
+    const int delayLength = windowLength - 1;
+    for (int channel = 0; channel < channels; ++channel)
+    {
+        float* line = delayLines[channel];
+        float* samples = buffer.getWritePointer(channel, startSample);
+        FloatVectorOperations::copy(line + delayLength, samples, numSamples);
+        FloatVectorOperations::multiply(samples, line, gainScratch, numSamples);
+        std::memmove(line, line + numSamples, sizeof(float) * (size_t)delayLength);
+
+        measureTruePeak(channel, samples, numSamples);
+
+        // About 300 ms of averaging, whatever the block size
+        const double alpha = 1.0 - std::exp(-numSamples / (0.3 * currentSampleRate));
+        const float level = buffer.getRMSLevel(channel, startSample, numSamples);
+        meanSquares[channel] += alpha * ((double)level * level - meanSquares[channel]);
+        rms[channel] = (float)std::sqrt(meanSquares[channel]);
+    }
+
+    gainReduction = gainScratch[numSamples - 1];
+    measureLoudness(buffer, startSample, numSamples, channels);
+}
+
+void MasterBus::computeLimiterGains(int numSamples)
+{
+    const float ceilingGain = ceiling;
+    const bool enabled = limiterEnabled;
+    const float releaseCoefficient = (float)(1.0 - std::exp(-1.0 / (releaseSeconds * currentSampleRate)));
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float peak = peakScratch[i];
+        const float needed = (enabled && peak > ceilingGain) ? ceilingGain / peak : 1.0f;
+
+        // Lowest gain needed anywhere in the window: drop the expired value from the front
+        // first, so a rising run never fills the ring, then larger values from the back
+        if (minimumCount > 0 && minimumTimes[minimumHead] <= sampleCounter - windowLength)
+        {
+            minimumHead = (minimumHead + 1) % windowLength;
+            --minimumCount;
+        }
+
+        while (minimumCount > 0 && minimumValues[(minimumHead + minimumCount - 1) % windowLength] >= needed)
+            --minimumCount;
+
+        const int tail = (minimumHead + minimumCount) % windowLength;
+        minimumTimes[tail] = sampleCounter;
+        minimumValues[tail] = needed;
+        ++minimumCount;
+        jassert(minimumCount <= windowLength);
+
+        ++sampleCounter;
+        const float held = minimumValues[minimumHead];
+
+        // Down at once, back up with the release time
+        releasedGain = held < releasedGain ? held : releasedGain + releaseCoefficient * (held - releasedGain);
+
+        // Averaging over the window turns the step into a smooth attack that still reaches
+        // the held gain exactly when the peak comes out of the delay line
+        averageSum += releasedGain - averageHistory[averagePosition];
+        averageHistory[averagePosition] = releasedGain;
+        averagePosition = (averagePosition + 1) % windowLength;
+
+        gainScratch[i] = (float)(averageSum / windowLength);
+    }
+}
+
+void MasterBus::measureTruePeak(int channel, const float* samples, int numSamples)
+{
+    const int historyLength = tapsPerPhase - 1;
+    float* history = peakHistory[channel];
+    FloatVectorOperations::copy(history + historyLength, samples, numSamples);
+
+    Vec coefficients[tapsPerPhase];
+    for (int tap = 0; tap < tapsPerPhase; ++tap)
+        coefficients[tap] = Vec::fromRawArray(phaseCoefficients + tap * (int)Vec::SIMDNumElements);
+
+    // Every output sample gives four interpolated points at once, one per lane
+    Vec peak = Vec::expand(0.0f);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float* x = history + historyLength + i;
+        Vec sum = coefficients[0] * x[0];
+        for (int tap = 1; tap < tapsPerPhase; ++tap)
+            sum += coefficients[tap] * x[-tap];
+
+        peak = Vec::max(peak, Vec::abs(sum));
+    }
+
+    std::memmove(history, history + numSamples, sizeof(float) * (size_t)historyLength);
+
+    for (size_t lane = 0; lane < (size_t)oversampling; ++lane)
+        blockTruePeak = jmax(blockTruePeak, peak.get(lane));
+}
+
+void MasterBus::measureLoudness(AudioBuffer<float>& buffer, int startSample, int numSamples, int channels)
+{
+    for (int channel = 0; channel < channels; ++channel)
+    {
+        float* weighted = weightedScratch + channel * maxBlockSize;
+        shelfFilters[channel].process(buffer.getReadPointer(channel, startSample), weighted, numSamples);
+        highPassFilters[channel].process(weighted, weighted, numSamples);
+    }
+
+    // Energy goes into 100 ms bins; momentary loudness averages 4 of them, short-term all 30
+    int i = 0;
+    while (i < numSamples)
+    {
+        const int numThisBin = jmin(numSamples - i, binLength - binPosition);
+
+        for (int channel = 0; channel < channels; ++channel)
+        {
+            const float* weighted = weightedScratch + channel * maxBlockSize + i;
+            double energy = 0.0;
+            for (int j = 0; j < numThisBin; ++j)
+                energy += weighted[j] * weighted[j];
+            binEnergy += energy;
+        }
+
+        binPosition += numThisBin;
+        i += numThisBin;
+
+        if (binPosition < binLength)
+            break;
+
+        loudnessBins[nextBin] = binEnergy / binLength;
+        nextBin = (nextBin + 1) % numLoudnessBins;
+        numBinsFilled = jmin(numLoudnessBins, numBinsFilled + 1);
+        binEnergy = 0.0;
+        binPosition = 0;
+
+        auto loudnessOf = [this](int numBins)
+        {
+            double sum = 0.0;
+            for (int bin = 1; bin <= numBins; ++bin)
+                sum += loudnessBins[(nextBin - bin + numLoudnessBins) % numLoudnessBins];
+
+            const double mean = sum / numBins;
+            return mean > 1.0e-10 ? (float)(-0.691 + 10.0 * std::log10(mean)) : -100.0f;
+        };
+
+        momentaryLoudness = loudnessOf(jmin(4, numBinsFilled));
+        shortTermLoudness = loudnessOf(numBinsFilled);
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+ * Final stage before the audio device: a look-ahead peak limiter followed
+ * by metering of what actually leaves the app.
+ *  - Limiter: the gain needed for each sample is held for the look-ahead
+ *    time and averaged over it, so it is fully down by the time a peak is
+ *    played and never overshoots the ceiling. Both channels share one gain.
+ *  - True peak: 4x oversampled (12 taps per phase, as BS.1770 suggests),
+ *    the four phases computed side by side in SIMDRegister lanes
+ *  - RMS per channel over about 300 ms
+ *  - Loudness in LUFS: K-weighted, momentary (400 ms) and short-term (3 s)
+ * Everything is sized in prepare(), process() never allocates. The meter
+ * readings are atomics, safe to read from the message thread.
+ */
+class MasterBus {
+public:
+    static constexpr int numChannels = 2;
+    static constexpr double lookAheadSeconds = 0.0015;
+
+    MasterBus();
+    ~MasterBus();
+
+    // Sizes the delay line and scratch buffers (not real-time safe)
+    void prepare(double sampleRate, int maximumBlockSize);
+    void releaseResources();
+
+    // Limits and meters the given range of the first two channels in place
+    void process(AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // ==== Limiter (any thread) ====
+    // Highest level the output may reach, default -1 dBFS to leave room for inter-sample peaks
+    void setCeilingDecibels(float decibels);
+    float getCeilingDecibels() const;
+    // How long the gain takes to recover after a peak, default 100 ms
+    void setReleaseSeconds(double seconds);
+    // When off, audio is still delayed by the same amount, so toggling doesn't jump
+    void setLimiterEnabled(bool shouldLimit);
+    bool isLimiterEnabled() const;
+
+    // Delay the look-ahead adds to the output, in samples and in seconds at the prepared rate
+    int getLatencySamples() const;
+    double getLatencySeconds() const;
+    // Average time spent in process() per block
+    double getAverageProcessMicroseconds() const;
+
+    // ==== Meters (any thread) ====
+    // Highest true peak of the last block, and the highest since resetTruePeakHold
+    float getTruePeakDecibels() const;
+    float getTruePeakHoldDecibels() const;
+    void resetTruePeakHold();
+    float getRmsDecibels(int channel) const;
+    float getMomentaryLoudness() const;
+    float getShortTermLoudness() const;
+    // How far the limiter is pulling the level down right now (0 or less)
+    float getGainReductionDecibels() const;
+
+private:
+    using Vec = dsp::SIMDRegister<float>;
+    static_assert(Vec::SIMDNumElements >= 4, "each true-peak phase needs its own SIMD lane");
+
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+    static constexpr int numLoudnessBins = 30;  // 100 ms each, enough for short-term loudness
+
+    // Transposed direct form II biquad, as in BandSplitEQ
+    struct Biquad {
+        float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        float z1 = 0, z2 = 0;
+        void reset() { z1 = z2 = 0; }
+        void process(const float* input, float* output, int numSamples);
+    };
+
+    void processChunk(AudioBuffer<float>& buffer, int startSample, int numSamples, int channels);
+    void computeLimiterGains(int numSamples);
+    void measureTruePeak(int channel, const float* samples, int numSamples);
+    void measureLoudness(AudioBuffer<float>& buffer, int startSample, int numSamples, int channels);
+
+    double currentSampleRate = 0.0;
+    int maxBlockSize = 0;
+
+    // ==== Limiter ====
+    int windowLength = 0;  // Look-ahead in samples; the audio is delayed by one less
+    HeapBlock<float> delayStorage;
+    float* delayLines[numChannels] = {};  // windowLength - 1 samples of history, then the current chunk
+    HeapBlock<float> peakScratch;
+    HeapBlock<float> gainScratch;
+
+    // Running minimum of the needed gain over the window (monotonic queue)
+    HeapBlock<int64> minimumTimes;
+    HeapBlock<float> minimumValues;
+    int minimumHead = 0;
+    int minimumCount = 0;
+    int64 sampleCounter = 0;
+
+    // Released gain, averaged over the window
+    float releasedGain = 1.0f;
+    HeapBlock<float> averageHistory;
+    int averagePosition = 0;
+    double averageSum = 0.0;
+
+    // ==== True peak ====
+    HeapBlock<float> phaseStorage;
+    float* phaseCoefficients = nullptr;  // tapsPerPhase rows of SIMD width, phases in the lanes
+    HeapBlock<float> peakHistoryStorage;
+    float* peakHistory[numChannels] = {};  // tapsPerPhase - 1 samples of history, then the chunk
+
+    // ==== Loudness ====
+    Biquad shelfFilters[numChannels];
+    Biquad highPassFilters[numChannels];
+    HeapBlock<float> weightedScratch;
+    double binEnergy = 0.0;
+    int binPosition = 0;
+    int binLength = 0;
+    double loudnessBins[numLoudnessBins] = {};
+    int numBinsFilled = 0;
+    int nextBin = 0;
+    double meanSquares[numChannels] = {};
+
+    // ==== Shared with the message thread ====
+    std::atomic<float> ceiling{ 0.891f };
+    std::atomic<double> releaseSeconds{ 0.1 };
+    std::atomic<bool> limiterEnabled{ true };
+    std::atomic<float> truePeak{ 0.0f };
+    std::atomic<float> truePeakHold{ 0.0f };
+    std::atomic<float> rms[numChannels];
+    std::atomic<float> momentaryLoudness{ -100.0f };
+    std::atomic<float> shortTermLoudness{ -100.0f };
+    std::atomic<float> gainReduction{ 1.0f };
+    std::atomic<double> averageMicroseconds{ 0.0 };
+    float blockTruePeak = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MasterBus)
+};
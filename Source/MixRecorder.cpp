@@ -0,0 +1,233 @@
+#include "MixRecorder.h"
+
+MixRecorder::MixRecorder()
+    : Thread("Mix recorder")
+{
+}
+
+MixRecorder::~MixRecorder()
+{
+    stop();
+}
+
+void MixRecorder::setBufferSeconds(double seconds)
+{
+    bufferSeconds = jlimit(0.5, 120.0, seconds);
+}
+
+double MixRecorder::getBufferSeconds() const
+{
+    return bufferSeconds;
+}
+
+bool MixRecorder::start(const File& fileToWrite, String& error)
+{
+    stop();
+
+    const double rate = sampleRate;
+    if (rate <= 0.0)
+    {
+        error = "The audio device isn't running";
+        return false;
+    }
+
+    std::unique_ptr<AudioFormat> format;
+    if (fileToWrite.hasFileExtension(".flac"))
+        format = std::make_unique<FlacAudioFormat>();
+    else
+        format = std::make_unique<WavAudioFormat>();
+
+    fileToWrite.deleteFile();
+    std::unique_ptr<FileOutputStream> stream(fileToWrite.createOutputStream());
+    if (stream == nullptr)
+    {
+        error = "Can't write " + fileToWrite.getFullPathName();
+        return false;
+    }
+
+    std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(stream.get(), rate, numChannels, 24, {}, 0));
+    if (writer == nullptr)
+    {
+        error = format->getFormatName() + " can't record at " + String(rate) + " Hz";
+        return false;
+    }
+    stream.release();  // Owned by the writer now
+
+    // Safe to resize: stop() has made sure the audio thread isn't in pushBlock
+    const int ringSize = jmax(4096, roundToInt(bufferSeconds * rate));
+    ring.setSize(numChannels, ringSize);
+    fifo.setTotalSize(ringSize);
+    fifo.reset();
+
+    // The writer gets a FIFO of its own as big as the ring, so short disk stalls are absorbed twice
+    writerThread.startThread();
+    threadedWriter = std::make_unique<AudioFormatWriter::ThreadedWriter>(writer.release(), writerThread, ringSize);
+
+    file = fileToWrite;
+    recordingSampleRate = rate;
+    samplesRecorded = 0;
+    overflowCount = 0;
+    droppedSamples = 0;
+    peakFill = 0;
+    averagePushMicroseconds = 0.0;
+    maxPushMicroseconds = 0.0;
+
+    startThread();
+    recording = true;
+    return true;
+}
+
+void MixRecorder::stop()
+{
+    if (threadedWriter == nullptr)
+        return;
+
+    // Shut the audio thread out, then wait for a push that was already under way
+    recording = false;
+    while (numPushing > 0)
+        Thread::yield();
+
+    // The drain thread empties the ring before it exits
+    stopThread(30000);
+
+    // Deleting the threaded writer flushes its own FIFO and finishes the file
+    threadedWriter = nullptr;
+    writerThread.stopThread(2000);
+}
+
+bool MixRecorder::isRecording() const
+{
+    return recording;
+}
+
+const File& MixRecorder::getFile() const
+{
+    return file;
+}
+
+void MixRecorder::prepare(double newSampleRate)
+{
+    // A running recording keeps the rate its file was opened with
+    sampleRate = newSampleRate;
+}
+
+void MixRecorder::pushBlock(const AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    ++numPushing;
+
+    if (recording && numSamples > 0 && buffer.getNumChannels() > 0)
+    {
+        const auto startTicks = Time::getHighResolutionTicks();
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+        if (size1 + size2 < numSamples)
+        {
+            // Waiting for the disk is never an option here
+            ++overflowCount;
+            droppedSamples += numSamples;
+        }
+        else
+        {
+            const int channels = jmin(buffer.getNumChannels(), (int)numChannels);
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                // A mono device records its one channel on both sides
+                const int source = jmin(channel, channels - 1);
+                ring.copyFrom(channel, start1, buffer, source, startSample, size1);
+                if (size2 > 0)
+                    ring.copyFrom(channel, start2, buffer, source, startSample + size1, size2);
+            }
+            fifo.finishedWrite(numSamples);
+            samplesRecorded += numSamples;
+
+            const int fill = fifo.getNumReady();
+            if (fill > peakFill)
+                peakFill = fill;
+        }
+
+        const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1.0e6;
+        averagePushMicroseconds = averagePushMicroseconds + 0.05 * (elapsed - averagePushMicroseconds);
+        if (elapsed > maxPushMicroseconds)
+            maxPushMicroseconds = elapsed;
+    }
+
+    --numPushing;
+}
+
+void MixRecorder::run()
+{
+    while (!threadShouldExit())
+    {
+        drain();
+        wait(5);
+    }
+
+    // The audio thread is shut out by now, so this empties the ring for good
+    while (!drain())
+        Thread::sleep(2);
+}
+
+bool MixRecorder::drain()
+{
+    const int numReady = fifo.getNumReady();
+    if (numReady == 0)
+        return true;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+    const float* channels[numChannels];
+    const int starts[] = { start1, start2 };
+    const int sizes[] = { size1, size2 };
+
+    for (int part = 0; part < 2; ++part)
+    {
+        if (sizes[part] == 0)
+            continue;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel] = ring.getReadPointer(channel, starts[part]);
+
+        // The writer's FIFO is full when the disk is behind, try again next time round
+        if (!threadedWriter->write(channels, sizes[part]))
+            return false;
+
+        fifo.finishedRead(sizes[part]);
+    }
+
+    return fifo.getNumReady() == 0;
+}
+
+double MixRecorder::getRecordedSeconds() const
+{
+    const double rate = recordingSampleRate;
+    return rate > 0.0 ? (double)samplesRecorded / rate : 0.0;
+}
+
+int MixRecorder::getOverflowCount() const
+{
+    return overflowCount;
+}
+
+int64 MixRecorder::getDroppedSamples() const
+{
+    return droppedSamples;
+}
+
+float MixRecorder::getPeakBufferFill() const
+{
+    const int size = fifo.getTotalSize();
+    return size > 1 ? (float)peakFill / (float)(size - 1) : 0.0f;
+}
+
+double MixRecorder::getAveragePushMicroseconds() const
+{
+    return averagePushMicroseconds;
+}
+
+double MixRecorder::getMaxPushMicroseconds() const
+{
+    return maxPushMicroseconds;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+#include <memory>
+
+/**
+ * Records the master output to a WAV or FLAC file while playing.
+ * The audio thread only copies each block into a preallocated lock-free ring
+ * buffer and bumps a few atomics: no locks, no allocation, no system calls,
+ * not even a wake-up. A background thread polls the ring every few
+ * milliseconds and feeds an AudioFormatWriter::ThreadedWriter, which encodes
+ * and writes on its own thread, so a slow disk only ever fills the ring.
+ * If the ring is full the block is dropped and counted rather than waited for.
+ */
+class MixRecorder : private Thread {
+public:
+    static constexpr int numChannels = 2;
+    static constexpr double defaultBufferSeconds = 10.0;
+
+    MixRecorder();
+    ~MixRecorder() override;
+
+    // ==== Message thread ====
+    // Ring buffer size, used from the next start() (default 10 s)
+    void setBufferSeconds(double seconds);
+    double getBufferSeconds() const;
+
+    // Opens the file and starts recording at the prepared sample rate, false with an error if not
+    bool start(const File& file, String& error);
+    // Writes out what is still buffered and closes the file
+    void stop();
+    bool isRecording() const;
+    const File& getFile() const;
+
+    // ==== Audio thread ====
+    // Sample rate for new recordings
+    void prepare(double sampleRate);
+    // Copies the range into the ring while recording, drops it if the ring is full
+    void pushBlock(const AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // ==== Statistics (any thread) ====
+    double getRecordedSeconds() const;
+    // Blocks and samples lost because the ring was full, since start()
+    int getOverflowCount() const;
+    int64 getDroppedSamples() const;
+    // Highest ring fill since start(), 0..1; close to 1 means the buffer is too small for the disk
+    float getPeakBufferFill() const;
+    // Cost of pushBlock on the audio thread, average and worst case since start()
+    double getAveragePushMicroseconds() const;
+    double getMaxPushMicroseconds() const;
+
+private:
+    // Drains the ring into the writer
+    void run() override;
+    // Moves everything the ring holds to the writer, false if the writer failed
+    bool drain();
+
+    // ==== Message thread ====
+    File file;
+    double bufferSeconds = defaultBufferSeconds;
+    TimeSliceThread writerThread{ "Mix recorder writer" };
+    std::unique_ptr<AudioFormatWriter::ThreadedWriter> threadedWriter;
+
+    // ==== Ring, written by the audio thread and read by the drain thread ====
+    AudioBuffer<float> ring;
+    AbstractFifo fifo{ 1 };
+
+    // ==== Shared between threads ====
+    std::atomic<double> sampleRate{ 0.0 };
+    std::atomic<double> recordingSampleRate{ 0.0 };  // Rate of the open file
+    std::atomic<bool> recording{ false };
+    std::atomic<int> numPushing{ 0 };  // Lets stop() wait until the audio thread is out of pushBlock
+    std::atomic<int64> samplesRecorded{ 0 };
+    std::atomic<int> overflowCount{ 0 };
+    std::atomic<int64> droppedSamples{ 0 };
+    std::atomic<int> peakFill{ 0 };
+    std::atomic<double> averagePushMicroseconds{ 0.0 };
+    std::atomic<double> maxPushMicroseconds{ 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MixRecorder)
+};
@@ -0,0 +1,346 @@
+#include "OfflineRenderer.h"
+#include "DeckManager.h"
+#include "MasterBus.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    bool parseEventType(const String& action, OfflineRenderer::Event::Type& type)
+    {
+        using Type = OfflineRenderer::Event::Type;
+        static const std::pair<const char*, Type> names[] = {
+            { "load", Type::load }, { "play", Type::play }, { "stop", Type::stop },
+            { "seek", Type::seek }, { "gain", Type::gain }, { "speed", Type::speed },
+            { "crossfader", Type::crossfader }, { "assign", Type::assign }
+        };
+
+        for (auto& name : names)
+        {
+            if (action == name.first)
+            {
+                type = name.second;
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+bool OfflineRenderer::Set::fromJSON(const var& json, const File& baseDirectory, Set& set, String& error)
+{
+    if (!json.isObject())
+    {
+        error = "The set is not a JSON object";
+        return false;
+    }
+
+    set.numDecks = jlimit(1, DeckManager::maxDecks, (int)json.getProperty("decks", 2));
+    set.lengthSeconds = (double)json.getProperty("length", 0.0);
+    set.events.clear();
+
+    if (auto* events = json["events"].getArray())
+    {
+        for (auto& item : *events)
+        {
+            Event event;
+            if (!parseEventType(item["action"].toString(), event.type))
+            {
+                error = "Unknown action \"" + item["action"].toString() + "\"";
+                return false;
+            }
+
+            event.timeSeconds = jmax(0.0, (double)item.getProperty("time", 0.0));
+            event.deck = (int)item.getProperty("deck", 0);
+            event.value = (double)item.getProperty("value", 0.0);
+            if (event.type == Event::Type::load)
+                event.file = baseDirectory.getChildFile(item["file"].toString());
+
+            if (event.type != Event::Type::crossfader && !isPositiveAndBelow(event.deck, set.numDecks))
+            {
+                error = "Event at " + String(event.timeSeconds) + " s uses deck " + String(event.deck)
+                    + ", the set has " + String(set.numDecks);
+                return false;
+            }
+
+            set.events.push_back(event);
+        }
+    }
+
+    // Without an explicit length, play on for a minute after the last event
+    if (set.lengthSeconds <= 0.0)
+    {
+        for (auto& event : set.events)
+            set.lengthSeconds = jmax(set.lengthSeconds, event.timeSeconds);
+        set.lengthSeconds += 60.0;
+    }
+
+    return true;
+}
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer(AudioFormatManager& _formatManager)
+    : formatManager(_formatManager)
+{
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+}
+
+std::unique_ptr<DeckTrack> OfflineRenderer::openTrack(const File& file, const Settings& settings, String& error)
+{
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (format == nullptr || reader == nullptr || reader->lengthInSamples <= 0 || reader->numChannels == 0)
+    {
+        error = "Can't read " + file.getFullPathName();
+        return nullptr;
+    }
+
+    const URL url(file);
+    auto track = std::make_unique<DeckTrack>(url, reader->sampleRate, reader->lengthInSamples, (int)reader->numChannels);
+
+    // Same choice as TrackLoader, except that nothing is streamed: a read-ahead thread
+    // could fall behind a faster-than-real-time render and make the output depend on timing
+    std::unique_ptr<MemoryMappedAudioFormatReader> mappedReader(format->createMemoryMappedReader(file));
+    if (mappedReader != nullptr && mappedReader->mapEntireFile())
+    {
+        track->setBody(std::make_unique<AudioFormatReaderSource>(mappedReader.release(), true));
+        track->setPlaybackMode(DeckTrack::PlaybackMode::memoryMapped);
+    }
+    else
+    {
+        auto decoded = trackCache->findOrDecode(DecodedTrackCache::makeKey(url), *reader,
+            [](double) { return true; });
+
+        // Too big for the cache: decode a private copy
+        if (decoded == nullptr)
+        {
+            auto copy = std::make_shared<DecodedTrack>();
+            copy->sampleRate = reader->sampleRate;
+            copy->buffer.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
+            reader->read(&copy->buffer, 0, (int)reader->lengthInSamples, 0, true, true);
+            decoded = copy;
+        }
+
+        track->setBody(std::make_unique<CachedTrackSource>(decoded));
+        track->setPlaybackMode(DeckTrack::PlaybackMode::cached);
+    }
+
+    track->prepareToPlay(settings.blockSize, settings.sampleRate);
+    return track;
+}
+
+OfflineRenderer::Result OfflineRenderer::render(const Set& set, const File& outputFile,
+    const Settings& settings, ProgressCallback onProgress)
+{
+    Result result;
+    const double sampleRate = settings.sampleRate;
+    const int blockSize = jmax(1, settings.blockSize);
+
+    // ==== Tracks, opened before the clock starts ====
+    std::vector<std::unique_ptr<DeckTrack>> tracks(set.events.size());
+    for (size_t i = 0; i < set.events.size(); ++i)
+    {
+        if (set.events[i].type == Event::Type::load)
+        {
+            tracks[i] = openTrack(set.events[i].file, settings, result.error);
+            if (tracks[i] == nullptr)
+                return result;
+        }
+    }
+
+    // Events in time order; ones at the same time keep the order they were listed in
+    std::vector<size_t> order(set.events.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&set](size_t a, size_t b)
+    {
+        return set.events[a].timeSeconds < set.events[b].timeSeconds;
+    });
+
+    // ==== Output ====
+    auto* format = formatManager.findFormatForFileExtension(outputFile.getFileExtension());
+    if (format == nullptr)
+    {
+        result.error = "No audio format for " + outputFile.getFileName();
+        return result;
+    }
+
+    outputFile.deleteFile();
+    std::unique_ptr<FileOutputStream> stream(outputFile.createOutputStream());
+    if (stream == nullptr)
+    {
+        result.error = "Can't write " + outputFile.getFullPathName();
+        return result;
+    }
+
+    std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate,
+        DeckManager::numChannels, settings.bitsPerSample, {}, 0));
+    if (writer == nullptr)
+    {
+        result.error = format->getFormatName() + " can't write " + String(settings.bitsPerSample)
+            + " bit at " + String(sampleRate) + " Hz";
+        return result;
+    }
+    stream.release();  // Owned by the writer now
+
+    // ==== Engine ====
+    DeckManager mixer;
+    std::vector<DJAudioPlayer*> decks;
+    for (int i = 0; i < set.numDecks; ++i)
+    {
+        auto* deck = mixer.addDeck();
+        mixer.setCrossfaderAssignment(deck, i % 2 == 0 ? Crossfader::Assignment::left : Crossfader::Assignment::right);
+        decks.push_back(deck);
+    }
+    mixer.prepareToPlay(blockSize, sampleRate);
+
+    MasterBus masterBus;
+    masterBus.prepare(sampleRate, blockSize);
+
+    // The limiter delays the audio, so render that much longer and drop the start
+    int samplesToSkip = settings.useMasterBus ? masterBus.getLatencySamples() : 0;
+    const int64 numOutputSamples = (int64)std::llround(set.lengthSeconds * sampleRate);
+    const int64 numRenderSamples = numOutputSamples + samplesToSkip;
+
+    AudioBuffer<float> block(DeckManager::numChannels, blockSize);
+    const float* outputChannels[DeckManager::numChannels];
+
+    TimeSliceThread writerThread("Bounce writer");
+    writerThread.startThread();
+    auto threadedWriter = std::make_unique<AudioFormatWriter::ThreadedWriter>(writer.release(), writerThread,
+        (int)(4.0 * sampleRate));
+
+    const auto startTicks = Time::getHighResolutionTicks();
+    const int64 progressInterval = (int64)sampleRate;
+    int64 nextProgress = progressInterval;
+    size_t nextEvent = 0;
+    int64 position = 0;
+
+    auto sampleOf = [&](size_t eventIndex)
+    {
+        return (int64)std::llround(set.events[order[eventIndex]].timeSeconds * sampleRate) + samplesToSkip;
+    };
+
+    while (position < numRenderSamples)
+    {
+        // Everything due now goes into the decks' queues, the next block picks it up
+        while (nextEvent < order.size() && sampleOf(nextEvent) <= position)
+        {
+            const size_t index = order[nextEvent++];
+            const Event& event = set.events[index];
+            DJAudioPlayer* deck = event.type == Event::Type::crossfader ? nullptr : decks[(size_t)event.deck];
+
+            switch (event.type)
+            {
+                case Event::Type::load:       deck->loadTrack(std::move(tracks[index])); break;
+                case Event::Type::play:       deck->start(); break;
+                case Event::Type::stop:       deck->stop(); break;
+                case Event::Type::seek:       deck->setPosition(event.value); break;
+                case Event::Type::gain:       deck->setGain(event.value); break;
+                case Event::Type::speed:      deck->setSpeed(event.value); break;
+                case Event::Type::crossfader: mixer.getCrossfader().setPosition((float)event.value); break;
+                case Event::Type::assign:
+                    mixer.setCrossfaderAssignment(deck, (Crossfader::Assignment)jlimit(0, 2, (int)event.value));
+                    break;
+            }
+        }
+
+        // Stop the block at the next event so it lands on its exact sample
+        int64 blockEnd = jmin(numRenderSamples, position + blockSize);
+        if (nextEvent < order.size())
+            blockEnd = jmin(blockEnd, sampleOf(nextEvent));
+        const int numSamples = (int)(blockEnd - position);
+
+        mixer.getNextAudioBlock(AudioSourceChannelInfo(&block, 0, numSamples));
+
+        // No message loop runs the decks' timers: a full retired-track queue would hold up
+        // their next load, and commands held back from a full queue would never be sent
+        for (auto* deck : decks)
+            deck->serviceQueues();
+        if (settings.useMasterBus)
+            masterBus.process(block, 0, numSamples);
+
+        const int skip = jmin(samplesToSkip, numSamples);
+        samplesToSkip -= skip;
+        if (numSamples > skip)
+        {
+            for (int channel = 0; channel < DeckManager::numChannels; ++channel)
+                outputChannels[channel] = block.getReadPointer(channel, skip);
+
+            // The writer's FIFO fills up when the disk is slower than rendering
+            while (!threadedWriter->write(outputChannels, numSamples - skip))
+                Thread::sleep(1);
+
+            result.samplesWritten += numSamples - skip;
+        }
+
+        position = blockEnd;
+
+        if (onProgress != nullptr && position >= nextProgress)
+        {
+            nextProgress += progressInterval;
+            if (!onProgress((double)position / (double)numRenderSamples))
+            {
+                result.error = "Cancelled";
+                break;
+            }
+        }
+    }
+
+    // Deleting the threaded writer flushes what is still queued and finishes the file
+    threadedWriter = nullptr;
+    writerThread.stopThread(2000);
+
+    result.wallSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+    result.realtimeFactor = result.wallSeconds > 0.0
+        ? (double)result.samplesWritten / sampleRate / result.wallSeconds : 0.0;
+    result.ok = result.error.isEmpty();
+
+    mixer.releaseResources();
+    masterBus.releaseResources();
+    return result;
+}
+
+int OfflineRenderer::runFromCommandLine(const StringArray& args)
+{
+    // args[0] is --render
+    if (args.size() < 3)
+    {
+        std::cerr << "Usage: OtoDecks --render <set.json> <output.wav|flac> [sampleRate]" << std::endl;
+        return 1;
+    }
+
+    const File setFile = File::getCurrentWorkingDirectory().getChildFile(args[1].unquoted());
+    const File outputFile = File::getCurrentWorkingDirectory().getChildFile(args[2].unquoted());
+
+    Set set;
+    String error;
+    if (!Set::fromJSON(JSON::parse(setFile), setFile.getParentDirectory(), set, error))
+    {
+        std::cerr << setFile.getFullPathName() << ": " << error << std::endl;
+        return 1;
+    }
+
+    Settings settings;
+    if (args.size() > 3 && args[3].getDoubleValue() > 0.0)
+        settings.sampleRate = args[3].getDoubleValue();
+
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    OfflineRenderer renderer(formatManager);
+
+    const Result result = renderer.render(set, outputFile, settings);
+    if (!result.ok)
+    {
+        std::cerr << "Render failed: " << result.error << std::endl;
+        return 1;
+    }
+
+    std::cout << "Rendered " << String((double)result.samplesWritten / settings.sampleRate, 1) << " s to "
+        << outputFile.getFullPathName() << " in " << String(result.wallSeconds, 2) << " s ("
+        << String(result.realtimeFactor, 1) << "x real time)" << std::endl;
+    return 0;
+}
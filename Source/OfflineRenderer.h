@@ -0,0 +1,88 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DeckTrack.h"
+#include "DecodedTrackCache.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Bounces a prepared set to a WAV or FLAC file without an audio device, as
+ * fast as the CPU allows.
+ * A set is a number of decks plus timed events (loads, play/stop, cue jumps,
+ * gain, speed and crossfader moves). The renderer builds its own DeckManager
+ * and MasterBus, pulls blocks from them in a tight loop and hands them to an
+ * AudioFormatWriter::ThreadedWriter, so encoding and disk writes overlap
+ * with rendering. Blocks are split at event times, so every event lands on
+ * its exact sample.
+ * Tracks are read from memory (memory-mapped or fully decoded) and decks
+ * render serially, so the same set always gives the same file: usable as a
+ * regression check of the audio engine on a machine without a sound card.
+ * Runs on the calling thread; the app's message loop isn't needed, only an
+ * initialised JUCE (the --render command line does this).
+ */
+class OfflineRenderer {
+public:
+    struct Event {
+        enum class Type { load, play, stop, seek, gain, speed, crossfader, assign };
+
+        double timeSeconds = 0.0;
+        Type type = Type::play;
+        int deck = 0;            // Ignored for crossfader moves
+        double value = 0.0;      // Seconds for seek, 0..1 for gain and crossfader, ratio for speed,
+                                 // 0/1/2 = left/right/thru for assign
+        File file;               // load only
+    };
+
+    struct Set {
+        int numDecks = 2;
+        double lengthSeconds = 0.0;
+        std::vector<Event> events;
+
+        // Reads a set from JSON, relative file paths are resolved against baseDirectory:
+        // { "decks": 2, "length": 90,
+        //   "events": [ { "time": 0, "deck": 0, "action": "load", "file": "a.wav" },
+        //               { "time": 0, "deck": 0, "action": "play" },
+        //               { "time": 30, "action": "crossfader", "value": 1 } ] }
+        static bool fromJSON(const var& json, const File& baseDirectory, Set& set, String& error);
+    };
+
+    struct Settings {
+        double sampleRate = 44100.0;
+        int blockSize = 512;
+        int bitsPerSample = 24;
+        bool useMasterBus = true;  // Limiter and meters, with its look-ahead delay compensated
+    };
+
+    struct Result {
+        bool ok = false;
+        String error;
+        int64 samplesWritten = 0;
+        double wallSeconds = 0.0;      // Rendering and writing, not counting opening the tracks
+        double realtimeFactor = 0.0;   // Seconds of audio per second of wall time
+    };
+
+    // Called now and then with 0..1, return false to cancel the render
+    using ProgressCallback = std::function<bool(double progress)>;
+
+    explicit OfflineRenderer(AudioFormatManager& formatManager);
+    ~OfflineRenderer();
+
+    // Renders the set into outputFile (replaced if it exists); the format comes from its extension
+    Result render(const Set& set, const File& outputFile, const Settings& settings,
+        ProgressCallback onProgress = nullptr);
+
+    // OtoDecks --render <set.json> <output.wav|flac> [sampleRate]
+    // Prints the result and returns the process exit code
+    static int runFromCommandLine(const StringArray& args);
+
+private:
+    // Opens a track so it plays from memory, prepared for the render settings
+    std::unique_ptr<DeckTrack> openTrack(const File& file, const Settings& settings, String& error);
+
+    AudioFormatManager& formatManager;
+    // Held as long as the renderer, so a cache nobody else uses isn't rebuilt for every track
+    SharedResourcePointer<DecodedTrackCache> trackCache;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineRenderer)
+};
@@ -1,11 +1,8 @@
 #include "PlaylistComponent.h"
 
-PlaylistComponent::PlaylistComponent(DJAudioPlayer* _player1, DJAudioPlayer* _player2, DeckGUI* _deck1, DeckGUI* _deck2)
-    : player1(_player1), player2(_player2), deck1(_deck1), deck2(_deck2)
+PlaylistComponent::PlaylistComponent(AudioFormatManager& formatManager)
+    : importer(formatManager)
 {
-    // Initialize format manager
-    formatManager.registerBasicFormats();
-
     // Set up the table
     addAndMakeVisible(tableComponent);
     tableComponent.setModel(this);
@@ -18,6 +15,8 @@ PlaylistComponent::PlaylistComponent(DJAudioPlayer* _player1, DJAudioPlayer* _pl
     tableComponent.setColour(TableListBox::backgroundColourId, Colour(0xFF2d3035));
     tableComponent.setColour(TableListBox::outlineColourId, Colour(0xFF3d4148));
     tableComponent.setOutlineThickness(1);
+    DBG("PlaylistComponent: library of " + String(library.getNumTracks()) + " tracks opened in "
+        + String(library.getOpenMilliseconds(), 1) + " ms");
 
     // Add button setup
     addAndMakeVisible(addButton);
@@ -29,9 +28,6 @@ PlaylistComponent::PlaylistComponent(DJAudioPlayer* _player1, DJAudioPlayer* _pl
     addButton.setColour(TextButton::textColourOnId, Colours::black);
     // Deck selector setup
     addAndMakeVisible(deckSelector);
-    deckSelector.addItem("Deck A", 1);
-    deckSelector.addItem("Deck B", 2);
-    deckSelector.setSelectedId(1);
     deckSelector.addListener(this);
     deckSelector.setColour(ComboBox::backgroundColourId, Colour(0xFF2d3035));
     deckSelector.setColour(ComboBox::outlineColourId, Colour(0xFF3d4148));
@@ -41,10 +37,59 @@ PlaylistComponent::PlaylistComponent(DJAudioPlayer* _player1, DJAudioPlayer* _pl
     deckSelectorLabel.setFont(Font(14.0f));
     deckSelectorLabel.setColour(Label::textColourId, Colour(0xFFaaaaaa));
     deckSelectorLabel.setJustificationType(Justification::right);
+    // Cache statistics
+    addAndMakeVisible(cacheStatsLabel);
+    cacheStatsLabel.setFont(Font(12.0f));
+    cacheStatsLabel.setColour(Label::textColourId, Colour(0xFF888888));
+    cacheStatsLabel.setJustificationType(Justification::right);
+    // Import progress, only shown while an import runs
+    addChildComponent(importProgressBar);
+
+    timerCallback();
+    frameScheduler->addClient(this, *this);
 }
 
 PlaylistComponent::~PlaylistComponent()
 {
+    frameScheduler->removeClient(this);
+    importer.cancel();
+}
+
+void PlaylistComponent::timerCallback()
+{
+    if (importer.isImporting())
+    {
+        // Still searching while the progress isn't known yet, the bar then spins
+        const double progress = importer.getProgress();
+        importProgress = progress > 0.0 ? progress : -1.0;
+        importProgressBar.setTextToDisplay("Importing " + String(importer.getNumDone()) + " / " + String(importer.getNumFound()));
+    }
+
+    auto hitPercent = [](int hits, int misses)
+    {
+        return hits + misses > 0 ? String(100 * hits / (hits + misses)) + "%" : String("-");
+    };
+
+    const auto waveforms = waveformCache->getStats();
+    const auto tracks = trackCache->getStats();
+    const String stats = "Waveforms " + String(waveforms.numFiles) + " / "
+        + String(waveforms.bytesOnDisk / (1024.0 * 1024.0), 1) + " MB, hits " + hitPercent(waveforms.hits, waveforms.misses)
+        + "\nDecoded " + String(tracks.numEntries) + " / "
+        + String(tracks.bytesUsed / (1024.0 * 1024.0), 0) + " MB, hits " + hitPercent(tracks.hits, tracks.misses);
+
+    // The caches only change while tracks load, which wakes the UI and starts the timer again
+    if (stats == cacheStatsLabel.getText() && !importer.isImporting())
+        stopTimer();
+    else
+        cacheStatsLabel.setText(stats, dontSendNotification);
+}
+
+bool PlaylistComponent::updateFrame()
+{
+    if (!isTimerRunning())
+        startTimer(1000);
+
+    return false;
 }
 
 void PlaylistComponent::paint(Graphics& g)
@@ -71,14 +116,18 @@ void PlaylistComponent::resized()
     // Position deck selector on the right and its label to the left of it
     deckSelector.setBounds(topArea.removeFromRight(100).reduced(5));
     deckSelectorLabel.setBounds(topArea.removeFromRight(120).reduced(5));
+    // Cache statistics fill the gap between the centred title and the deck selector
+    const int statsWidth = jlimit(0, 280, topArea.getRight() - getWidth() / 2 - 50);
+    cacheStatsLabel.setBounds(topArea.removeFromRight(statsWidth).reduced(5, 0));
 
     addButton.setBounds(topArea.removeFromLeft(40).reduced(5));
+    importProgressBar.setBounds(topArea.removeFromLeft(jmin(220, topArea.getWidth() / 3)).reduced(5, 8));
     tableComponent.setBounds(area);
 }
 
 int PlaylistComponent::getNumRows()
 {
-    return tracks.size();
+    return library.getNumTracks();
 }
 
 void PlaylistComponent::paintRowBackground(Graphics& g, int rowNumber, int width, int height, bool rowIsSelected)
@@ -107,20 +156,21 @@ void PlaylistComponent::paintCell(Graphics& g, int rowNumber, int columnId, int
         g.setColour(rowIsSelected ? Colours::white : Colour(0xFFaaaaaa));
         g.setFont(14.0f);
 
+        const auto& track = library.getTrack(rowNumber);
         String text;
 
         switch (columnId)
         {
         case 1:
-            text = tracks[rowNumber].title;
+            text = track.title;
             break;
 
         case 2:
-            text = tracks[rowNumber].artist;
+            text = track.artist;
             break;
 
         case 3:
-            text = getTimeString(tracks[rowNumber].duration);
+            text = getTimeString(track.duration);
             break;
 
         default:
@@ -175,17 +225,14 @@ void PlaylistComponent::buttonClicked(Button* button)
         int id = button->getComponentID().getIntValue();
 
         // Make sure the ID is valid
-        if (id >= 0 && id < tracks.size())
+        if (id >= 0 && id < library.getNumTracks())
         {
-            // Get the selected deck
-            int deckId = deckSelector.getSelectedId();
-            DJAudioPlayer* playerToLoad = (deckId == 1) ? player1 : player2;
-            DeckGUI* deckToLoad = (deckId == 1) ? deck1 : deck2;
+            // Get the selected deck (item IDs start at 1)
+            DeckGUI* deckToLoad = decks[deckSelector.getSelectedId() - 1];
             // Load the track to the selected deck
-            if (playerToLoad != nullptr)
+            if (deckToLoad != nullptr)
             {
-                playerToLoad->loadURL(tracks[id].fileURL);
-                deckToLoad->waveformDisplay.loadURL(tracks[id].fileURL);
+                deckToLoad->loadTrack(URL{ library.getTrack(id).file });
                 // Select the row to show which track is loaded
                 tableComponent.selectRow(id);
             }
@@ -200,41 +247,78 @@ void PlaylistComponent::comboBoxChanged(ComboBox* comboBoxThatHasChanged)
 
 }
 
+void PlaylistComponent::setDecks(const Array<DeckGUI*>& newDecks)
+{
+    decks = newDecks;
+
+    // Keep the current target if it still exists
+    const int selectedId = deckSelector.getSelectedId();
+    deckSelector.clear(dontSendNotification);
+    for (int i = 0; i < decks.size(); ++i)
+        deckSelector.addItem("Deck " + String::charToString((juce_wchar)('A' + decks[i]->getDeckId())), i + 1);
+
+    deckSelector.setSelectedId(jlimit(1, jmax(1, decks.size()), selectedId), dontSendNotification);
+}
+
 void PlaylistComponent::addToPlaylist()
 {
-    // Configure the file chooser dialog
-    auto fileChooserFlags = FileBrowserComponent::canSelectFiles;
+    // Any mix of files and folders, folders are searched for tracks recursively
+    auto fileChooserFlags = FileBrowserComponent::canSelectFiles
+        | FileBrowserComponent::canSelectDirectories
+        | FileBrowserComponent::canSelectMultipleItems;
 
     // Launch asynchronously using the same pattern as in DeckGUI
     fChooser.launchAsync(fileChooserFlags, [this](const FileChooser& chooser)
     {
-        auto result = chooser.getResult();
-
-        if (result.existsAsFile())
-        {
-            URL fileURL = URL{ result };
-
-            // Try to get metadata
-            String title = result.getFileNameWithoutExtension();
-            String artist = "Unknown Artist";
+        auto results = chooser.getResults();
+        if (!results.isEmpty())
+            importFiles(results);
+    });
+}
 
-            // Get file duration
-            double duration = 0.0;
-            auto* reader = formatManager.createReaderFor(result);
-            if (reader != nullptr)
-            {
-                duration = reader->lengthInSamples / reader->sampleRate;
-                delete reader;
-            }
+void PlaylistComponent::importFiles(const Array<File>& filesAndFolders)
+{
+    // Tracks already in the library are only read again if they changed since
+    auto knownFiles = std::make_shared<LibraryImporter::KnownFiles>();
+    knownFiles->reserve((size_t)library.getNumTracks());
+    for (int i = 0; i < library.getNumTracks(); ++i)
+    {
+        const auto& track = library.getTrack(i);
+        knownFiles->emplace(track.file.getFullPathName(), track.modificationTime);
+    }
 
-            // Add to our tracks vector
-            tracks.push_back(TrackInfo(title, artist, fileURL, duration));
+    importProgress = -1.0;
+    importProgressBar.setTextToDisplay("Searching...");
+    importProgressBar.setVisible(true);
+    startTimer(250);
 
-            // Update the table
+    importer.start(filesAndFolders, knownFiles,
+        [this](std::vector<TrackLibrary::Track> tracks)
+        {
+            // One write to the library and one table update per batch
+            library.put(tracks);
             tableComponent.updateContent();
             tableComponent.repaint();
-        }
-    });
+        },
+        [this]
+        {
+            importProgressBar.setVisible(false);
+            startTimer(1000);
+        });
+}
+
+bool PlaylistComponent::isInterestedInFileDrag(const StringArray& files)
+{
+    return true;
+}
+
+void PlaylistComponent::filesDropped(const StringArray& files, int x, int y)
+{
+    Array<File> filesAndFolders;
+    for (auto& path : files)
+        filesAndFolders.add(File(path));
+
+    importFiles(filesAndFolders);
 }
 
 String PlaylistComponent::getTimeString(double seconds)
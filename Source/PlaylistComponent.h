@@ -4,30 +4,26 @@
 #include "DJAudioPlayer.h"
 #include "DeckGUI.h"
 #include "DeckGUILookAndFeel.h"
+#include "DecodedTrackCache.h"
+#include "WaveformDiskCache.h"
+#include "TrackLibrary.h"
+#include "LibraryImporter.h"
 #include <vector>
 #include <string>
 
 using namespace std;
 
-// A struct to hold track information
-struct TrackInfo {
-    String title;
-    String artist;
-    URL fileURL;
-    double duration = 0.0; // in seconds
-
-    TrackInfo(String _title, String _artist, URL _fileURL, double _duration)
-        : title(_title), artist(_artist), fileURL(_fileURL), duration(_duration) {}
-};
-
 class PlaylistComponent : public Component,
     public TableListBoxModel,
     public Button::Listener,
-    public ComboBox::Listener
+    public ComboBox::Listener,
+    public FileDragAndDropTarget,
+    private Timer,
+    private FrameScheduler::Client
 {
 public:
-    // Constructor takes references to both deck players and UIs
-    PlaylistComponent(DJAudioPlayer* _player1, DJAudioPlayer* _player2, DeckGUI* _deck1, DeckGUI* _deck2);
+    // Constructor takes the format manager used to read imported files, the decks are set with setDecks
+    PlaylistComponent(AudioFormatManager& formatManager);
     ~PlaylistComponent() override;
 
     // Component interface methods
@@ -44,29 +40,46 @@ public:
     void buttonClicked(Button* button) override;
     void comboBoxChanged(ComboBox* comboBoxThatHasChanged) override;
 
+    // Files and folders dropped on the playlist are imported like those picked with "+"
+    bool isInterestedInFileDrag(const StringArray& files) override;
+    void filesDropped(const StringArray& files, int x, int y) override;
+
     // Playlist management methods
-    void addToPlaylist();  // Add a new track to the playlist
+    void addToPlaylist();  // Add tracks or whole folders to the playlist
+    // Imports files and folders (searched recursively) in the background
+    void importFiles(const Array<File>& filesAndFolders);
     juce::String getTimeString(double seconds);  // Format time as MM:SS
 
+    // Decks the tracks can be loaded to, called whenever decks are added or removed
+    void setDecks(const Array<DeckGUI*>& newDecks);
+
 
 private:
-    TableListBox tableComponent;
-    vector<TrackInfo> tracks;
+    // Refreshes the cache statistics once a second, stopping once they stay the same
+    void timerCallback() override;
+    // Loads always wake the UI, so that restarts the statistics
+    bool updateFrame() override;
 
-    // Reference to the deck players
-    DJAudioPlayer* player1;
-    DJAudioPlayer* player2;
+    TableListBox tableComponent;
+    // The tracks, kept on disk between runs
+    TrackLibrary library{ TrackLibrary::getDefaultDirectory() };
 
-    // Reference to the deck GUIs
-    DeckGUI* deck1;
-    DeckGUI* deck2;
+    // The deck GUIs, in selector order
+    Array<DeckGUI*> decks;
     // UI Components
     TextButton addButton{ "+" };
     ComboBox deckSelector;
     Label deckSelectorLabel{ "", "Target Deck:" };
+    Label cacheStatsLabel;
     DeckGUILookAndFeel playlistLookAndFeel;
     FileChooser fChooser{ "+" };
-    // File operations
-    AudioFormatManager formatManager;
+    // Imports run in the background, rows are added a batch at a time
+    LibraryImporter importer;
+    double importProgress = 0.0;
+    ProgressBar importProgressBar{ importProgress };
+    // Only read for their statistics
+    SharedResourcePointer<WaveformDiskCache> waveformCache;
+    SharedResourcePointer<DecodedTrackCache> trackCache;
+    SharedResourcePointer<FrameScheduler> frameScheduler;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaylistComponent)
 };
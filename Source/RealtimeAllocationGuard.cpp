@@ -0,0 +1,272 @@
+#include "RealtimeAllocationGuard.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_DEBUG
+
+// Where the C allocator can be watched as well, HeapBlock (and so AudioBuffer::setSize)
+// is caught too. operator new then goes through the watched malloc and isn't counted twice.
+#if JUCE_LINUX && defined(__GLIBC__)
+ #define OTODECKS_WATCH_MALLOC 1
+ #include <cerrno>
+ extern "C" void* __libc_malloc(std::size_t);
+ extern "C" void* __libc_calloc(std::size_t, std::size_t);
+ extern "C" void* __libc_realloc(void*, std::size_t);
+ extern "C" void* __libc_memalign(std::size_t, std::size_t);
+ extern "C" void __libc_free(void*);
+#elif JUCE_MAC
+ #define OTODECKS_WATCH_MALLOC 1
+ #include <malloc/malloc.h>
+ #include <mach/mach.h>
+ #include <pthread.h>
+#elif JUCE_WINDOWS && defined(_DEBUG)
+ #define OTODECKS_WATCH_MALLOC 1
+ #include <crtdbg.h>
+#else
+ #define OTODECKS_WATCH_MALLOC 0
+#endif
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+namespace
+{
+   #if JUCE_MAC
+    // thread_local may allocate on first use, which would recurse from inside malloc;
+    // a pthread key never does
+    pthread_key_t forbiddenKey = []
+    {
+        pthread_key_t key;
+        pthread_key_create(&key, nullptr);
+        return key;
+    }();
+
+    bool isForbidden() noexcept { return pthread_getspecific(forbiddenKey) != nullptr; }
+    void setForbidden(bool forbidden) noexcept { pthread_setspecific(forbiddenKey, forbidden ? &forbiddenKey : nullptr); }
+   #else
+    thread_local bool allocationForbidden = false;
+
+    bool isForbidden() noexcept { return allocationForbidden; }
+    void setForbidden(bool forbidden) noexcept { allocationForbidden = forbidden; }
+   #endif
+
+    std::atomic<int> violationCount{ 0 };
+
+    void checkAllocationAllowed() noexcept
+    {
+        if (isForbidden())
+        {
+            // Lift the ban while asserting, the assertion logger allocates itself
+            setForbidden(false);
+            ++violationCount;
+            jassertfalse; // Heap allocation or release inside a real-time section
+            setForbidden(true);
+        }
+    }
+
+    void checkNewAllowed() noexcept
+    {
+       #if ! OTODECKS_WATCH_MALLOC
+        checkAllocationAllowed();
+       #endif
+    }
+
+    void* allocate(std::size_t size) noexcept
+    {
+        checkNewAllowed();
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+    {
+        checkNewAllowed();
+        const auto align = jmax((std::size_t)alignment, sizeof(void*));
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size == 0 ? 1 : size, align);
+       #else
+        void* ptr = nullptr;
+        return posix_memalign(&ptr, align, size == 0 ? 1 : size) == 0 ? ptr : nullptr;
+       #endif
+    }
+
+    void releaseAligned(void* ptr) noexcept
+    {
+       #if JUCE_WINDOWS
+        _aligned_free(ptr);
+       #else
+        std::free(ptr);
+       #endif
+    }
+
+    void* allocateOrThrow(std::size_t size)
+    {
+        if (auto* ptr = allocate(size))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+
+    void* allocateAlignedOrThrow(std::size_t size, std::align_val_t alignment)
+    {
+        if (auto* ptr = allocateAligned(size, alignment))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+
+   #if JUCE_MAC
+    // The default zone's entry points, swapped for checking ones at startup
+    malloc_zone_t originalZone;
+
+    void* zoneMalloc(malloc_zone_t* zone, size_t size) { checkAllocationAllowed(); return originalZone.malloc(zone, size); }
+    void* zoneCalloc(malloc_zone_t* zone, size_t count, size_t size) { checkAllocationAllowed(); return originalZone.calloc(zone, count, size); }
+    void* zoneValloc(malloc_zone_t* zone, size_t size) { checkAllocationAllowed(); return originalZone.valloc(zone, size); }
+    void* zoneRealloc(malloc_zone_t* zone, void* ptr, size_t size) { checkAllocationAllowed(); return originalZone.realloc(zone, ptr, size); }
+    void* zoneMemalign(malloc_zone_t* zone, size_t alignment, size_t size) { checkAllocationAllowed(); return originalZone.memalign(zone, alignment, size); }
+
+    void zoneFree(malloc_zone_t* zone, void* ptr)
+    {
+        if (ptr != nullptr)
+            checkAllocationAllowed();
+        originalZone.free(zone, ptr);
+    }
+
+    void zoneFreeDefiniteSize(malloc_zone_t* zone, void* ptr, size_t size)
+    {
+        if (ptr != nullptr)
+            checkAllocationAllowed();
+        originalZone.free_definite_size(zone, ptr, size);
+    }
+
+    const bool zoneWatched = []
+    {
+        // malloc() uses the first registered zone, which isn't always malloc_default_zone()
+        vm_address_t* zones = nullptr;
+        unsigned int numZones = 0;
+        auto* zone = malloc_get_all_zones(mach_task_self(), nullptr, &zones, &numZones) == KERN_SUCCESS && numZones > 0
+            ? reinterpret_cast<malloc_zone_t*>(zones[0])
+            : malloc_default_zone();
+
+        // The zone is read-only after startup
+        if (vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(malloc_zone_t), 0, VM_PROT_READ | VM_PROT_WRITE) != KERN_SUCCESS)
+            return false;
+
+        originalZone = *zone;
+        zone->malloc = zoneMalloc;
+        zone->calloc = zoneCalloc;
+        zone->valloc = zoneValloc;
+        zone->realloc = zoneRealloc;
+        zone->free = zoneFree;
+        if (zone->version >= 5)
+            zone->memalign = zoneMemalign;
+        if (zone->version >= 6)
+            zone->free_definite_size = zoneFreeDefiniteSize;
+
+        vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(malloc_zone_t), 0, VM_PROT_READ);
+        return true;
+    }();
+   #elif JUCE_WINDOWS && defined(_DEBUG)
+    // The debug CRT reports every malloc, realloc and free, including _aligned_malloc's
+    int allocHook(int, void*, size_t, int blockType, long, const unsigned char*, int)
+    {
+        if (blockType != _CRT_BLOCK)
+            checkAllocationAllowed();
+        return TRUE;
+    }
+
+    const _CRT_ALLOC_HOOK previousAllocHook = _CrtSetAllocHook(allocHook);
+   #endif
+}
+
+#if JUCE_LINUX && defined(__GLIBC__)
+// Replace glibc's malloc family, forwarding to the real allocator once checked
+extern "C" void* malloc(std::size_t size) noexcept { checkAllocationAllowed(); return __libc_malloc(size); }
+extern "C" void* calloc(std::size_t count, std::size_t size) noexcept { checkAllocationAllowed(); return __libc_calloc(count, size); }
+extern "C" void* realloc(void* ptr, std::size_t size) noexcept { checkAllocationAllowed(); return __libc_realloc(ptr, size); }
+extern "C" void* memalign(std::size_t alignment, std::size_t size) noexcept { checkAllocationAllowed(); return __libc_memalign(alignment, size); }
+extern "C" void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept { checkAllocationAllowed(); return __libc_memalign(alignment, size); }
+
+extern "C" int posix_memalign(void** result, std::size_t alignment, std::size_t size) noexcept
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    checkAllocationAllowed();
+    auto* ptr = __libc_memalign(alignment, size);
+    if (ptr == nullptr)
+        return ENOMEM;
+
+    *result = ptr;
+    return 0;
+}
+
+extern "C" void free(void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        checkAllocationAllowed();
+    __libc_free(ptr);
+}
+#endif
+
+// Replace the global allocation functions, aligned ones included, so the guard sees every new/new[]
+void* operator new(std::size_t size) { return allocateOrThrow(size); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned(size, alignment); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { releaseAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { releaseAligned(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { releaseAligned(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { releaseAligned(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(ptr); }
+
+RealtimeAllocationGuard::ScopedNoAllocation::ScopedNoAllocation()
+    : wasForbidden(isForbidden())
+{
+    setForbidden(true);
+}
+
+RealtimeAllocationGuard::ScopedNoAllocation::~ScopedNoAllocation()
+{
+    setForbidden(wasForbidden);
+}
+
+bool RealtimeAllocationGuard::isAllocationForbidden() noexcept
+{
+    return isForbidden();
+}
+
+int RealtimeAllocationGuard::getViolationCount() noexcept
+{
+    return violationCount.load();
+}
+
+#else
+
+RealtimeAllocationGuard::ScopedNoAllocation::ScopedNoAllocation() {}
+RealtimeAllocationGuard::ScopedNoAllocation::~ScopedNoAllocation() {}
+
+bool RealtimeAllocationGuard::isAllocationForbidden() noexcept
+{
+    return false;
+}
+
+int RealtimeAllocationGuard::getViolationCount() noexcept
+{
+    return 0;
+}
+
+#endif
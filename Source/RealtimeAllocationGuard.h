@@ -0,0 +1,31 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+ * Debug-build check that code running on the audio thread never touches the heap.
+ * While a ScopedNoAllocation is alive on a thread, any operator new (aligned or not) on
+ * that same thread hits a jassert. On Linux (glibc), macOS and the Windows debug CRT,
+ * malloc, calloc, realloc and free are caught too, so HeapBlock and AudioBuffer::setSize
+ * can't slip past. In release builds the guard compiles to nothing.
+ */
+class RealtimeAllocationGuard {
+public:
+    // Forbids heap allocation on the calling thread for the lifetime of the object
+    class ScopedNoAllocation {
+    public:
+        ScopedNoAllocation();
+        ~ScopedNoAllocation();
+
+    private:
+       #if JUCE_DEBUG
+        bool wasForbidden;
+       #endif
+        JUCE_DECLARE_NON_COPYABLE(ScopedNoAllocation)
+    };
+
+    // True while the calling thread is inside a ScopedNoAllocation (always false in release)
+    static bool isAllocationForbidden() noexcept;
+
+    // Number of allocations caught since the app started (always 0 in release)
+    static int getViolationCount() noexcept;
+};
@@ -0,0 +1,177 @@
+#include "RealtimeWorkerPool.h"
+
+namespace
+{
+    uint32 makeClaimState(uint32 generation, int numJobs, int nextJob)
+    {
+        return (generation << 16) | ((uint32)numJobs << 8) | (uint32)nextJob;
+    }
+}
+
+class RealtimeWorkerPool::Worker : public Thread {
+public:
+    Worker(RealtimeWorkerPool& _pool, int index)
+        : Thread("Deck render " + String(index + 1)), pool(_pool)
+    {
+    }
+
+    void run() override
+    {
+        // Spinning this long after the last job catches batches that follow quickly without a wake-up
+        const int64 spinTicks = Time::secondsToHighResolutionTicks(0.0002);
+        int64 idleSince = Time::getHighResolutionTicks();
+
+        while (!threadShouldExit())
+        {
+            if (pool.runNextJob())
+            {
+                idleSince = Time::getHighResolutionTicks();
+                continue;
+            }
+
+            if (Time::getHighResolutionTicks() - idleSince < spinTicks)
+                continue;
+
+            // Check for work after announcing the sleep, so a batch posted in between isn't missed.
+            // With that, only dispatch() and stop() need to wake us, an idle pool never wakes up.
+            sleeping = true;
+            if (!pool.hasUnclaimedJob())
+                wakeUp.wait(-1);
+            sleeping = false;
+            idleSince = Time::getHighResolutionTicks();
+        }
+    }
+
+    void wakeIfSleeping()
+    {
+        if (sleeping)
+            wakeUp.signal();
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        wakeUp.signal();
+        stopThread(1000);
+    }
+
+private:
+    RealtimeWorkerPool& pool;
+    WaitableEvent wakeUp;
+    std::atomic<bool> sleeping{ false };
+};
+
+RealtimeWorkerPool::RealtimeWorkerPool()
+{
+}
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    stop();
+}
+
+void RealtimeWorkerPool::start(int numWorkers, double periodMs)
+{
+    stop();
+
+    // Without a spare core the workers would only take turns with the audio thread
+    numWorkers = jmin(numWorkers, (int)maxWorkers);
+    if (numWorkers <= 0)
+        return;
+
+    // Real-time like the audio thread, so a worker isn't preempted halfway through a deck
+    const auto options = Thread::RealtimeOptions{}.withPeriodMs(periodMs);
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        Worker* worker = workers.add(new Worker(*this, i));
+        if (!worker->startRealtimeThread(options))
+            worker->startThread(Thread::Priority::highest);
+    }
+
+    workerPeriodMs = periodMs;
+    accepting = true;
+}
+
+void RealtimeWorkerPool::stop()
+{
+    // Once the audio thread is out of run() it won't touch the workers again
+    accepting = false;
+    while (numRunning > 0)
+        Thread::yield();
+
+    for (auto* worker : workers)
+        worker->stop();
+    workers.clear();
+}
+
+int RealtimeWorkerPool::getNumWorkers() const
+{
+    return workers.size();
+}
+
+double RealtimeWorkerPool::getPeriodMs() const
+{
+    return workerPeriodMs;
+}
+
+bool RealtimeWorkerPool::run(Batch& batch, int numJobs)
+{
+    jassert(numJobs <= maxJobs);
+
+    ++numRunning;
+    if (!accepting)
+    {
+        --numRunning;
+        return false;
+    }
+
+    // Publish the batch, then the claim state that makes it visible to the workers
+    currentBatch = &batch;
+    numJobsDone = 0;
+    generation = (generation + 1) & 0xffff;
+    claimState = makeClaimState(generation, jmin(numJobs, (int)maxJobs), 0);
+
+    for (auto* worker : workers)
+        worker->wakeIfSleeping();
+
+    // Help out: every job no worker has claimed yet runs here
+    while (runNextJob())
+    {
+    }
+
+    // Only jobs a worker is in the middle of are left. They usually end within the spin;
+    // past it the worker may have been preempted on this core, so give it the core back.
+    const int64 spinEndTicks = Time::getHighResolutionTicks() + Time::secondsToHighResolutionTicks(0.0001);
+    while (numJobsDone < jmin(numJobs, (int)maxJobs))
+    {
+        if (Time::getHighResolutionTicks() > spinEndTicks)
+            Thread::yield();
+    }
+
+    --numRunning;
+    return true;
+}
+
+bool RealtimeWorkerPool::hasUnclaimedJob() const
+{
+    const uint32 state = claimState;
+    return (state & 0xff) < ((state >> 8) & 0xff);
+}
+
+bool RealtimeWorkerPool::runNextJob()
+{
+    // The generation is part of the state, so a claim made against a finished batch fails
+    uint32 state = claimState;
+    while ((state & 0xff) < ((state >> 8) & 0xff))
+    {
+        if (claimState.compare_exchange_weak(state, state + 1))
+        {
+            ScopedNoDenormals noDenormals;
+            currentBatch.load()->runJob((int)(state & 0xff));
+            ++numJobsDone;
+            return true;
+        }
+    }
+
+    return false;
+}
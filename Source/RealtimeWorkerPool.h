@@ -0,0 +1,69 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+ * Runs batches of independent jobs from the audio thread on a few
+ * real-time worker threads, with the audio thread working alongside them.
+ * Workers are scheduled like the audio thread itself (with the callback
+ * period as a hint), falling back to the highest normal priority where
+ * real-time threads aren't allowed.
+ * Jobs are claimed one at a time from a shared counter, so whichever thread
+ * is free takes the next one, and the audio thread runs every job no worker
+ * has claimed yet. Only a job a worker is already running is waited for: by
+ * spinning briefly, then by yielding the core in case that worker was
+ * preempted on it. Workers spin briefly after a batch, then sleep on an
+ * event until the next one. Running a batch never allocates or locks, apart
+ * from signalling a sleeping worker.
+ */
+class RealtimeWorkerPool {
+public:
+    // A set of jobs numbered from 0, each safe to run on any thread
+    class Batch {
+    public:
+        virtual ~Batch() = default;
+        virtual void runJob(int index) = 0;
+    };
+
+    static constexpr int maxWorkers = 16;
+    static constexpr int maxJobs = 255;
+
+    RealtimeWorkerPool();
+    ~RealtimeWorkerPool();
+
+    // ==== Message thread ====
+    // Starts the workers, replacing any running ones; with 0 workers the pool stays stopped.
+    // periodMs is how often the audio thread will post batches (its callback period).
+    void start(int numWorkers, double periodMs);
+    // Waits for a running batch to finish, then ends the workers
+    void stop();
+    int getNumWorkers() const;
+    double getPeriodMs() const;
+
+    // ==== Audio thread ====
+    // Runs every job of the batch and returns once they are all done.
+    // Returns false without running anything if the pool isn't started.
+    bool run(Batch& batch, int numJobs);
+
+private:
+    class Worker;
+
+    // Claims and runs one job of the current batch, false if none are left
+    bool runNextJob();
+    bool hasUnclaimedJob() const;
+
+    OwnedArray<Worker> workers;
+    double workerPeriodMs = 0.0;
+
+    // Set while the workers may be used, and while the audio thread is in run()
+    std::atomic<bool> accepting{ false };
+    std::atomic<int> numRunning{ 0 };
+
+    // Current batch: generation in the top 16 bits, job count and next job in the two lower bytes
+    std::atomic<Batch*> currentBatch{ nullptr };
+    std::atomic<uint32> claimState{ 0 };
+    std::atomic<int> numJobsDone{ 0 };
+    uint32 generation = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealtimeWorkerPool)
+};
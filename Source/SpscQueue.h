@@ -0,0 +1,79 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <array>
+
+/**
+ * Fixed-size single-producer, single-consumer queue built on AbstractFifo.
+ * One thread pushes and one other thread pops, with no locks and no
+ * allocation, so it is safe to use from the audio thread.
+ * Holds up to capacity - 1 items (AbstractFifo keeps one slot free).
+ */
+template <typename Type, int capacity>
+class SpscQueue {
+public:
+    SpscQueue() = default;
+
+    // Producer side, returns false if the queue is full
+    bool push(const Type& item)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 + size2 == 0)
+            return false;
+
+        items[(size_t)(size1 > 0 ? start1 : start2)] = item;
+        fifo.finishedWrite(1);
+        return true;
+    }
+
+    // Consumer side, copies the oldest item without removing it
+    bool peek(Type& item) const
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+
+        if (size1 + size2 == 0)
+            return false;
+
+        item = items[(size_t)(size1 > 0 ? start1 : start2)];
+        return true;
+    }
+
+    // Consumer side, removes the item returned by the last successful peek
+    void discardFront()
+    {
+        fifo.finishedRead(1);
+    }
+
+    bool pop(Type& item)
+    {
+        if (!peek(item))
+            return false;
+
+        discardFront();
+        return true;
+    }
+
+    // Consumer side, visits every queued item in order without removing any
+    template <typename Callback>
+    void forEachReady(Callback&& callback)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            callback(items[(size_t)(start1 + i)]);
+        for (int i = 0; i < size2; ++i)
+            callback(items[(size_t)(start2 + i)]);
+    }
+
+    bool isFull() const { return fifo.getFreeSpace() == 0; }
+    int getNumReady() const { return fifo.getNumReady(); }
+
+private:
+    AbstractFifo fifo{ capacity };
+    std::array<Type, (size_t)capacity> items{};
+
+    JUCE_DECLARE_NON_COPYABLE(SpscQueue)
+};
@@ -0,0 +1,365 @@
+#include "TimeStretchSource.h"
+#include <cstring>
+
+namespace
+{
+    // Feeds the benchmark a steady tone with a few partials, so the search has something to line up
+    class TestToneSource : public AudioSource {
+    public:
+        void prepareToPlay(int, double) override {}
+        void releaseResources() override {}
+        void getNextAudioBlock(const AudioSourceChannelInfo& info) override
+        {
+            for (int i = 0; i < info.numSamples; ++i)
+            {
+                phase += 0.0125f;
+                if (phase > MathConstants<float>::twoPi)
+                    phase -= MathConstants<float>::twoPi;
+
+                const float sample = 0.4f * std::sin(phase) + 0.2f * std::sin(3.0f * phase) + 0.1f * std::sin(7.0f * phase);
+                for (int channel = 0; channel < info.buffer->getNumChannels(); ++channel)
+                    info.buffer->setSample(channel, info.startSample + i, sample);
+            }
+        }
+
+    private:
+        float phase = 0.0f;
+    };
+}
+
+TimeStretchSource::TimeStretchSource(AudioSource* inputSource, int _numChannels)
+    : input(inputSource), numChannels(jmax(1, _numChannels))
+{
+    jassert(input != nullptr);
+}
+
+TimeStretchSource::~TimeStretchSource()
+{
+}
+
+TimeStretchSource::Settings TimeStretchSource::getSettings(Quality q)
+{
+    // Longer frames keep bass intact, a wider and finer search avoids phasiness on transients
+    switch (q)
+    {
+        case Quality::low:  return { 512, 128, 8, 4 };
+        case Quality::high: return { 2048, 512, 8, 2 };
+        default:            return { 1024, 256, 8, 2 };
+    }
+}
+
+void TimeStretchSource::setTempo(double newTempo)
+{
+    tempo = jlimit(0.0, maxTempo, newTempo);
+}
+
+double TimeStretchSource::getTempo() const
+{
+    return tempo;
+}
+
+void TimeStretchSource::setQuality(Quality newQuality)
+{
+    quality = newQuality;
+}
+
+TimeStretchSource::Quality TimeStretchSource::getQuality() const
+{
+    return quality;
+}
+
+double TimeStretchSource::getAverageProcessMicroseconds() const
+{
+    return averageMicroseconds;
+}
+
+void TimeStretchSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    maxPullSize = jmax(1, samplesPerBlockExpected);
+
+    // Everything is sized for the highest quality, so switching later never allocates
+    const Settings largest = getSettings(Quality::high);
+    const double scale = sampleRate / 44100.0;
+    const int maxFrameLength = 2 * jmax(16, roundToInt(largest.frameLength * scale / 2.0));
+    const int maxSearchRadius = roundToInt(largest.searchRadius * scale);
+
+    // Room for a frame at the fastest tempo plus the search on both sides, and slack for compacting
+    inputCapacity = 6 * maxFrameLength + 4 * maxSearchRadius;
+    inputBuffer.setSize(numChannels, inputCapacity);
+    monoInput.calloc((size_t)inputCapacity);
+
+    overlapBuffer.setSize(numChannels, maxFrameLength);
+    outputBuffer.setSize(numChannels, maxFrameLength);
+    window.calloc((size_t)maxFrameLength);
+
+    configure(quality);
+    reset();
+}
+
+void TimeStretchSource::releaseResources()
+{
+    inputBuffer.setSize(0, 0);
+    monoInput.free();
+    overlapBuffer.setSize(0, 0);
+    outputBuffer.setSize(0, 0);
+    window.free();
+    inputCapacity = 0;
+    frameLength = 0;
+}
+
+void TimeStretchSource::configure(Quality newQuality)
+{
+    const Settings settings = getSettings(newQuality);
+    const double scale = currentSampleRate / 44100.0;
+
+    hopSize = jmax(16, roundToInt(settings.frameLength * scale / 2.0));
+    frameLength = 2 * hopSize;
+    searchRadius = roundToInt(settings.searchRadius * scale);
+    searchStep = settings.searchStep;
+    stride = settings.stride;
+    appliedQuality = newQuality;
+
+    // Periodic Hann, so windows overlapping by half a frame sum to exactly one
+    for (int i = 0; i < frameLength; ++i)
+        window[(size_t)i] = 0.5f - 0.5f * std::cos(MathConstants<float>::twoPi * (float)i / (float)frameLength);
+}
+
+void TimeStretchSource::flushBuffers()
+{
+    reset();
+}
+
+void TimeStretchSource::reset()
+{
+    inputValid = 0;
+    analysisPosition = 0.0;
+    previousFrameStart = 0;
+    hasPreviousFrame = false;
+    overlapBuffer.clear();
+    outputReadPosition = 0;
+    outputAvailable = 0;
+}
+
+void TimeStretchSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    // Not prepared yet
+    if (frameLength == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    ScopedNoDenormals noDenormals;
+    const auto startTicks = Time::getHighResolutionTicks();
+
+    const Quality newQuality = quality;
+    if (newQuality != appliedQuality)
+    {
+        configure(newQuality);
+        reset();
+    }
+
+    // Standing still: repeating the same frame would only buzz, so nothing is played and the input waits
+    if (tempo.load() == 0.0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    AudioBuffer<float>& buffer = *bufferToFill.buffer;
+    const int numOutputChannels = jmin(buffer.getNumChannels(), numChannels);
+    int numDone = 0;
+
+    while (numDone < bufferToFill.numSamples)
+    {
+        if (outputAvailable == 0)
+            processFrame();
+
+        const int numThisTime = jmin(outputAvailable, bufferToFill.numSamples - numDone);
+
+        for (int channel = 0; channel < numOutputChannels; ++channel)
+            buffer.copyFrom(channel, bufferToFill.startSample + numDone, outputBuffer, channel, outputReadPosition, numThisTime);
+
+        outputReadPosition += numThisTime;
+        outputAvailable -= numThisTime;
+        numDone += numThisTime;
+    }
+
+    for (int channel = numOutputChannels; channel < buffer.getNumChannels(); ++channel)
+        buffer.clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+
+    const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1.0e6;
+    averageMicroseconds = averageMicroseconds + 0.05 * (elapsed - averageMicroseconds);
+}
+
+void TimeStretchSource::processFrame()
+{
+    const int idealStart = (int)analysisPosition;
+    const int naturalStart = previousFrameStart + hopSize;
+
+    // The search may pick a frame up to searchRadius past the ideal start
+    pullInput(jmax(idealStart + searchRadius, hasPreviousFrame ? naturalStart : 0) + frameLength);
+
+    const int frameStart = hasPreviousFrame ? findBestFrameStart(idealStart, naturalStart) : idealStart;
+    jassert(frameStart + frameLength <= inputValid);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* accumulator = overlapBuffer.getWritePointer(channel);
+        FloatVectorOperations::addWithMultiply(accumulator, inputBuffer.getReadPointer(channel, frameStart), window, frameLength);
+
+        // The first hop has had both of its overlapping frames now, so it is finished
+        FloatVectorOperations::copy(outputBuffer.getWritePointer(channel), accumulator, hopSize);
+        std::memmove(accumulator, accumulator + hopSize, sizeof(float) * (size_t)(frameLength - hopSize));
+        FloatVectorOperations::clear(accumulator + frameLength - hopSize, hopSize);
+    }
+
+    outputReadPosition = 0;
+    outputAvailable = hopSize;
+
+    // Output always advances one hop, the input advances one hop scaled by the tempo
+    previousFrameStart = frameStart;
+    hasPreviousFrame = true;
+    analysisPosition += hopSize * tempo.load();
+
+    discardInput();
+}
+
+void TimeStretchSource::pullInput(int numNeeded)
+{
+    jassert(numNeeded <= inputCapacity);
+    numNeeded = jmin(numNeeded, inputCapacity);
+
+    // Read in blocks no bigger than the input was prepared for, so it never has to reallocate
+    while (inputValid < numNeeded)
+    {
+        const int numThisTime = jmin(maxPullSize, numNeeded - inputValid);
+        input->getNextAudioBlock(AudioSourceChannelInfo(&inputBuffer, inputValid, numThisTime));
+
+        // The search only looks at a mono mix, its scale doesn't matter
+        float* mono = monoInput + inputValid;
+        FloatVectorOperations::copy(mono, inputBuffer.getReadPointer(0, inputValid), numThisTime);
+        for (int channel = 1; channel < numChannels; ++channel)
+            FloatVectorOperations::add(mono, inputBuffer.getReadPointer(channel, inputValid), numThisTime);
+
+        inputValid += numThisTime;
+    }
+}
+
+void TimeStretchSource::discardInput()
+{
+    // Nothing before the next search range or the previous frame's continuation is needed again
+    const int keepFrom = jmin((int)analysisPosition - searchRadius, previousFrameStart + hopSize);
+
+    // Compact only once a whole frame can go, so the move is amortised
+    if (keepFrom < frameLength)
+        return;
+
+    const int numLeft = inputValid - keepFrom;
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* data = inputBuffer.getWritePointer(channel);
+        std::memmove(data, data + keepFrom, sizeof(float) * (size_t)numLeft);
+    }
+    std::memmove(monoInput.get(), monoInput + keepFrom, sizeof(float) * (size_t)numLeft);
+
+    inputValid = numLeft;
+    analysisPosition -= keepFrom;
+    previousFrameStart -= keepFrom;
+}
+
+int TimeStretchSource::findBestFrameStart(int idealStart, int naturalStart) const
+{
+    const int lowest = jmax(0, idealStart - searchRadius);
+    const int highest = idealStart + searchRadius;
+
+    // Coarse pass over the whole range on decimated samples
+    int best = jlimit(lowest, highest, idealStart);
+    float bestScore = -1.0e30f;
+    for (int candidate = lowest; candidate <= highest; candidate += searchStep)
+    {
+        const float score = similarity(candidate, naturalStart, stride);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+
+    // Fine pass around the winner at full resolution
+    if (searchStep > 1 || stride > 1)
+    {
+        const int coarseBest = best;
+        bestScore = similarity(coarseBest, naturalStart, 1);
+
+        for (int candidate = jmax(lowest, coarseBest - searchStep + 1); candidate <= jmin(highest, coarseBest + searchStep - 1); ++candidate)
+        {
+            if (candidate == coarseBest)
+                continue;
+
+            const float score = similarity(candidate, naturalStart, 1);
+            if (score > bestScore)
+            {
+                bestScore = score;
+                best = candidate;
+            }
+        }
+    }
+
+    return best;
+}
+
+float TimeStretchSource::similarity(int candidateStart, int naturalStart, int step) const
+{
+    // Normalised cross-correlation over the overlap, so loud candidates don't win by level alone
+    const float* candidate = monoInput + candidateStart;
+    const float* natural = monoInput + naturalStart;
+
+    // Two independent sums per term keep the FPU pipeline busy without needing fast-math
+    float correlation[2] = {};
+    float energy[2] = {};
+    int i = 0;
+
+    for (; i + step < hopSize; i += 2 * step)
+    {
+        correlation[0] += candidate[i] * natural[i];
+        energy[0] += candidate[i] * candidate[i];
+        correlation[1] += candidate[i + step] * natural[i + step];
+        energy[1] += candidate[i + step] * candidate[i + step];
+    }
+
+    for (; i < hopSize; i += step)
+    {
+        correlation[0] += candidate[i] * natural[i];
+        energy[0] += candidate[i] * candidate[i];
+    }
+
+    return (correlation[0] + correlation[1]) / std::sqrt(energy[0] + energy[1] + 1.0e-9f);
+}
+
+double TimeStretchSource::measureMicrosecondsPerBlock(Quality qualityToMeasure, double tempoToMeasure,
+    int blockSize, double sampleRate)
+{
+    blockSize = jmax(1, blockSize);
+    TestToneSource tone;
+    TimeStretchSource stretcher(&tone, 2);
+    stretcher.setQuality(qualityToMeasure);
+    stretcher.prepareToPlay(blockSize, sampleRate);
+    stretcher.setTempo(tempoToMeasure);
+
+    // A couple of seconds of audio, the first blocks only warm up the caches
+    AudioBuffer<float> output(2, blockSize);
+    const int numBlocks = jmax(20, (int)(2.0 * sampleRate / blockSize));
+    int64 ticksSpent = 0;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        const auto startTicks = Time::getHighResolutionTicks();
+        stretcher.getNextAudioBlock(AudioSourceChannelInfo(output));
+        if (block >= 10)
+            ticksSpent += Time::getHighResolutionTicks() - startTicks;
+    }
+
+    return Time::highResolutionTicksToSeconds(ticksSpent) * 1.0e6 / (numBlocks - 10);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+ * Changes the tempo of its input without changing its pitch (key lock).
+ * Uses WSOLA: overlapping Hann-windowed frames are taken from the input at
+ * the tempo-scaled position, each one nudged within a small search range to
+ * the offset that best lines up with where the previous frame left off, and
+ * overlap-added at a fixed hop.
+ * Works like ResamplingAudioSource: it pulls from an input source, and all
+ * buffers are sized in prepareToPlay for the largest quality setting, so
+ * tempo and quality can change on the audio thread without allocating.
+ */
+class TimeStretchSource : public AudioSource {
+public:
+    // Frame length and search width, trading smearing and phasiness against CPU
+    enum class Quality { low, medium, high };
+
+    // The input is not owned, it must have numChannels channels
+    TimeStretchSource(AudioSource* inputSource, int numChannels = 2);
+    ~TimeStretchSource() override;
+
+    // Playback tempo (1.0 = original, clamped to 0..4), the pitch stays the same. At 0 the output is silent.
+    void setTempo(double newTempo);
+    double getTempo() const;
+
+    // Takes effect on the next block, restarting the stretcher
+    void setQuality(Quality newQuality);
+    Quality getQuality() const;
+
+    // Drops everything buffered, e.g. after the input was seeked (audio thread)
+    void flushBuffers();
+
+    // Average time spent per block, to compare the quality settings
+    double getAverageProcessMicroseconds() const;
+
+    // Stretches a test tone off the audio thread and returns the cost in microseconds per block
+    static double measureMicrosecondsPerBlock(Quality quality, double tempo, int blockSize = 128, double sampleRate = 44100.0);
+
+    // ==== AudioSource interface methods ====
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    static constexpr double maxTempo = 4.0;
+
+private:
+    // Frame length, search radius, coarse search step and correlation stride (at 44.1 kHz)
+    struct Settings {
+        int frameLength;
+        int searchRadius;
+        int searchStep;
+        int stride;
+    };
+    static Settings getSettings(Quality quality);
+
+    // Sets frame and search sizes for the quality and sample rate (never allocates)
+    void configure(Quality newQuality);
+    void reset();
+
+    // Makes one new hop of output from the next frame of input
+    void processFrame();
+    void pullInput(int numNeeded);
+    void discardInput();
+    int findBestFrameStart(int idealStart, int naturalStart) const;
+    float similarity(int candidateStart, int naturalStart, int step) const;
+
+    AudioSource* input;
+    const int numChannels;
+    double currentSampleRate = 0.0;
+
+    int maxPullSize = 0;  // The input was prepared for blocks of this size
+
+    // Current setup, derived from the quality
+    Quality appliedQuality = Quality::medium;
+    int frameLength = 0;
+    int hopSize = 0;
+    int searchRadius = 0;
+    int searchStep = 1;
+    int stride = 1;
+
+    // Input kept for the search, compacted as frames move on; monoInput mirrors it as a mono mix
+    AudioBuffer<float> inputBuffer;
+    HeapBlock<float> monoInput;
+    int inputCapacity = 0;
+    int inputValid = 0;
+    double analysisPosition = 0.0;  // Tempo-scaled start of the next frame, in inputBuffer samples
+    int previousFrameStart = 0;
+    bool hasPreviousFrame = false;
+
+    // Overlap-add accumulator and the finished hop waiting to be played
+    AudioBuffer<float> overlapBuffer;
+    AudioBuffer<float> outputBuffer;
+    int outputReadPosition = 0;
+    int outputAvailable = 0;
+    HeapBlock<float> window;
+
+    std::atomic<double> tempo{ 1.0 };
+    std::atomic<Quality> quality{ Quality::medium };
+    std::atomic<double> averageMicroseconds{ 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimeStretchSource)
+};
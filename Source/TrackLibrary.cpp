@@ -0,0 +1,381 @@
+#include "TrackLibrary.h"
+#include <array>
+#include <cstring>
+
+namespace
+{
+    // "OTLI", version, generation, number of tracks, body checksum, body size
+    const size_t indexHeaderSize = 4 + 4 + 8 + 4 + 4 + 8;
+    // "OTLL", version, generation
+    const size_t logHeaderSize = 4 + 4 + 8;
+    // Log records start with the payload size and its checksum
+    const size_t recordHeaderSize = 4 + 4;
+
+    // CRC-32 as used by zip and PNG
+    uint32 crc32(const void* data, size_t size)
+    {
+        static const auto table = []
+        {
+            std::array<uint32, 256> entries{};
+            for (uint32 i = 0; i < 256; ++i)
+            {
+                uint32 c = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    c = (c & 1) != 0 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                entries[i] = c;
+            }
+            return entries;
+        }();
+
+        uint32 crc = 0xffffffffu;
+        const auto* bytes = static_cast<const uint8*>(data);
+        for (size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+        return crc ^ 0xffffffffu;
+    }
+}
+
+TrackLibrary::TrackLibrary(const File& directory)
+    : indexFile(directory.getChildFile("library.idx")),
+      logFile(directory.getChildFile("library.log"))
+{
+    const double startTime = Time::getMillisecondCounterHiRes();
+    directory.createDirectory();
+
+    if (indexFile.existsAsFile() && !loadIndex())
+    {
+        DBG("TrackLibrary: damaged index " + indexFile.getFullPathName() + ", reading the log only");
+        tracks.clear();
+        indexByPath.clear();
+        generation = 0;
+    }
+
+    int64 validLogSize = 0;
+    replayLog(validLogSize);
+    openLogForAppending(validLogSize);
+
+    openMilliseconds = Time::getMillisecondCounterHiRes() - startTime;
+}
+
+TrackLibrary::~TrackLibrary()
+{
+    // The next start then reads a single index
+    if (numLogRecords > 0)
+        compact();
+}
+
+File TrackLibrary::getDefaultDirectory()
+{
+    return File::getSpecialLocation(File::userApplicationDataDirectory)
+        .getChildFile("OtoDecks").getChildFile("Library");
+}
+
+int TrackLibrary::getNumTracks() const
+{
+    return (int)tracks.size();
+}
+
+const TrackLibrary::Track& TrackLibrary::getTrack(int index) const
+{
+    jassert(index >= 0 && index < getNumTracks());
+    return tracks[(size_t)index];
+}
+
+int TrackLibrary::indexOf(const File& file) const
+{
+    const auto found = indexByPath.find(file.getFullPathName());
+    return found != indexByPath.end() ? found->second : -1;
+}
+
+void TrackLibrary::put(const Track& track)
+{
+    put(std::vector<Track>{ track });
+}
+
+void TrackLibrary::put(const std::vector<Track>& newTracks)
+{
+    MemoryOutputStream payload;
+    for (auto& track : newTracks)
+    {
+        applyPut(track);
+
+        payload.reset();
+        payload.writeByte((char)putRecord);
+        writeTrack(payload, track);
+        writeLogRecord(payload.getMemoryBlock());
+    }
+
+    if (logStream != nullptr)
+        logStream->flush();
+
+    compactIfLogIsLarge();
+}
+
+void TrackLibrary::remove(const File& file)
+{
+    if (indexOf(file) < 0)
+        return;
+
+    applyRemove(file);
+
+    MemoryOutputStream payload;
+    payload.writeByte((char)removeRecord);
+    payload.writeString(file.getFullPathName());
+    writeLogRecord(payload.getMemoryBlock());
+
+    if (logStream != nullptr)
+        logStream->flush();
+
+    compactIfLogIsLarge();
+}
+
+bool TrackLibrary::compact()
+{
+    MemoryOutputStream body;
+    for (auto& track : tracks)
+        writeTrack(body, track);
+
+    const uint64 newGeneration = generation + 1;
+
+    // Written next to the index and moved over it, so there is always one complete index
+    TemporaryFile temporary(indexFile);
+    {
+        std::unique_ptr<FileOutputStream> stream(temporary.getFile().createOutputStream());
+        if (stream == nullptr)
+            return false;
+
+        const bool ok = stream->write("OTLI", 4)
+            && stream->writeInt((int)fileVersion)
+            && stream->writeInt64((int64)newGeneration)
+            && stream->writeInt(getNumTracks())
+            && stream->writeInt((int)crc32(body.getData(), body.getDataSize()))
+            && stream->writeInt64((int64)body.getDataSize())
+            && stream->write(body.getData(), body.getDataSize());
+        stream->flush();
+
+        if (!ok || stream->getStatus().failed())
+        {
+            DBG("TrackLibrary::compact couldn't write " + temporary.getFile().getFullPathName());
+            return false;
+        }
+    }
+
+    if (!temporary.overwriteTargetFileWithTemporary())
+        return false;
+
+    // If we stop before the new log is written, the old one is older than the index
+    // and is ignored on the next start, the index already holds its records
+    generation = newGeneration;
+    logStream = nullptr;
+    openLogForAppending(0);
+    return true;
+}
+
+double TrackLibrary::getOpenMilliseconds() const
+{
+    return openMilliseconds;
+}
+
+int TrackLibrary::getNumLogRecords() const
+{
+    return numLogRecords;
+}
+
+bool TrackLibrary::loadIndex()
+{
+    // Strings are copied out, so the mapping only lives while reading
+    MemoryMappedFile mapped(indexFile, MemoryMappedFile::readOnly);
+    const auto* data = static_cast<const char*>(mapped.getData());
+    const size_t size = mapped.getSize();
+
+    if (data == nullptr || size < indexHeaderSize || std::memcmp(data, "OTLI", 4) != 0
+        || ByteOrder::littleEndianInt(data + 4) != fileVersion)
+        return false;
+
+    const uint64 bodySize = ByteOrder::littleEndianInt64(data + 24);
+    if (bodySize != size - indexHeaderSize
+        || crc32(data + indexHeaderSize, (size_t)bodySize) != ByteOrder::littleEndianInt(data + 20))
+        return false;
+
+    const int numTracks = (int)ByteOrder::littleEndianInt(data + 16);
+    tracks.reserve((size_t)numTracks);
+    indexByPath.reserve((size_t)numTracks);
+
+    MemoryInputStream body(data + indexHeaderSize, (size_t)bodySize, false);
+    for (int i = 0; i < numTracks; ++i)
+    {
+        Track track;
+        if (!readTrack(body, track))
+            return false;
+        applyPut(track);
+    }
+
+    generation = ByteOrder::littleEndianInt64(data + 8);
+    return true;
+}
+
+bool TrackLibrary::replayLog(int64& validLogSize)
+{
+    validLogSize = 0;
+
+    MemoryBlock data;
+    if (!logFile.existsAsFile() || !logFile.loadFileAsData(data))
+        return false;
+
+    const auto* bytes = static_cast<const char*>(data.getData());
+    const size_t size = data.getSize();
+    if (size < logHeaderSize || std::memcmp(bytes, "OTLL", 4) != 0
+        || ByteOrder::littleEndianInt(bytes + 4) != fileVersion)
+        return false;
+
+    // A log older than the index was compacted into it already
+    const uint64 logGeneration = ByteOrder::littleEndianInt64(bytes + 8);
+    if (logGeneration < generation)
+        return false;
+    generation = logGeneration;
+
+    size_t position = logHeaderSize;
+    while (position + recordHeaderSize <= size)
+    {
+        const uint32 payloadSize = ByteOrder::littleEndianInt(bytes + position);
+        const uint32 checksum = ByteOrder::littleEndianInt(bytes + position + 4);
+        const char* payloadStart = bytes + position + recordHeaderSize;
+
+        // A record cut short by a crash, or damaged, ends the log
+        if (payloadSize > size - position - recordHeaderSize || crc32(payloadStart, payloadSize) != checksum)
+            break;
+
+        MemoryInputStream payload(payloadStart, payloadSize, false);
+        const auto type = (uint8)payload.readByte();
+        if (type == putRecord)
+        {
+            Track track;
+            if (readTrack(payload, track))
+                applyPut(track);
+        }
+        else if (type == removeRecord)
+        {
+            const String path = payload.readString();
+            if (File::isAbsolutePath(path))
+                applyRemove(File(path));
+        }
+
+        position += recordHeaderSize + payloadSize;
+        ++numLogRecords;
+    }
+
+    if (position < size)
+        DBG("TrackLibrary: log damaged after " + String((int64)position) + " bytes, dropping the rest");
+
+    validLogSize = (int64)position;
+    return true;
+}
+
+void TrackLibrary::openLogForAppending(int64 validLogSize)
+{
+    // No usable log, start a new one for the current index
+    if (validLogSize == 0)
+    {
+        logFile.deleteFile();
+        numLogRecords = 0;
+    }
+
+    logStream = std::make_unique<FileOutputStream>(logFile);
+    if (logStream->failedToOpen())
+    {
+        DBG("TrackLibrary: couldn't open " + logFile.getFullPathName() + ", changes won't be saved");
+        logStream = nullptr;
+        return;
+    }
+
+    if (validLogSize == 0)
+    {
+        writeLogHeader(*logStream);
+        logStream->flush();
+    }
+    else if (logStream->getPosition() > validLogSize)
+    {
+        // New records go straight after the last good one
+        logStream->setPosition(validLogSize);
+        logStream->truncate();
+    }
+}
+
+bool TrackLibrary::writeLogHeader(OutputStream& stream) const
+{
+    return stream.write("OTLL", 4)
+        && stream.writeInt((int)fileVersion)
+        && stream.writeInt64((int64)generation);
+}
+
+bool TrackLibrary::writeLogRecord(const MemoryBlock& payload)
+{
+    if (logStream == nullptr)
+        return false;
+
+    ++numLogRecords;
+    return logStream->writeInt((int)payload.getSize())
+        && logStream->writeInt((int)crc32(payload.getData(), payload.getSize()))
+        && logStream->write(payload.getData(), payload.getSize());
+}
+
+void TrackLibrary::compactIfLogIsLarge()
+{
+    // Replaying a long log would slow down the next start more than rewriting the index now
+    if (numLogRecords >= 1024 && numLogRecords > getNumTracks() / 4)
+        compact();
+}
+
+void TrackLibrary::applyPut(const Track& track)
+{
+    const String path = track.file.getFullPathName();
+    const auto found = indexByPath.find(path);
+    if (found != indexByPath.end())
+    {
+        tracks[(size_t)found->second] = track;
+        return;
+    }
+
+    indexByPath.emplace(path, getNumTracks());
+    tracks.push_back(track);
+}
+
+void TrackLibrary::applyRemove(const File& file)
+{
+    const int index = indexOf(file);
+    if (index < 0)
+        return;
+
+    indexByPath.erase(file.getFullPathName());
+    tracks.erase(tracks.begin() + index);
+
+    // Every later track moved down by one
+    for (int i = index; i < getNumTracks(); ++i)
+        indexByPath[tracks[(size_t)i].file.getFullPathName()] = i;
+}
+
+void TrackLibrary::writeTrack(OutputStream& stream, const Track& track)
+{
+    stream.writeString(track.file.getFullPathName());
+    stream.writeString(track.title);
+    stream.writeString(track.artist);
+    stream.writeInt64(track.modificationTime);
+    stream.writeInt64(track.fileSize);
+    stream.writeDouble(track.duration);
+}
+
+bool TrackLibrary::readTrack(InputStream& stream, Track& track)
+{
+    const String path = stream.readString();
+    track.title = stream.readString();
+    track.artist = stream.readString();
+
+    if (!File::isAbsolutePath(path) || stream.getNumBytesRemaining() < 8 + 8 + 8)
+        return false;
+
+    track.file = File(path);
+    track.modificationTime = stream.readInt64();
+    track.fileSize = stream.readInt64();
+    track.duration = stream.readDouble();
+    return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The track library, kept on disk between runs.
+ * Every change is appended to a log and flushed straight away, so nothing is
+ * lost if the app quits unexpectedly. Once the log has grown, the whole
+ * library is written out as one compact binary index and the log starts
+ * again. On opening, the index is memory-mapped and read in a single pass,
+ * then the log is replayed on top, so even a very large library opens
+ * without touching a single audio file.
+ * Both files are versioned and checksummed: a damaged log is cut back to its
+ * last good record, a damaged index is skipped.
+ * Message thread only.
+ */
+class TrackLibrary {
+public:
+    struct Track {
+        File file;                    // Identifies the track, one entry per file
+        String title;
+        String artist;
+        double duration = 0.0;        // In seconds, 0 if unknown
+        int64 modificationTime = 0;   // Of the audio file when it was added, in milliseconds
+        int64 fileSize = 0;
+    };
+
+    static constexpr uint32 fileVersion = 1;
+
+    // Opens the library stored in directory, creating it if needed
+    explicit TrackLibrary(const File& directory);
+    // Compacts the log into the index if it has grown
+    ~TrackLibrary();
+
+    // Where the app keeps its library
+    static File getDefaultDirectory();
+
+    int getNumTracks() const;
+    // In the order they were first added
+    const Track& getTrack(int index) const;
+    // Index of the track for file, -1 if it isn't in the library
+    int indexOf(const File& file) const;
+
+    // Adds tracks, or replaces those already in the library for the same file.
+    // Written to disk together, so adding a whole folder costs one flush.
+    void put(const Track& track);
+    void put(const std::vector<Track>& newTracks);
+    void remove(const File& file);
+
+    // Writes the whole library as a fresh index and empties the log
+    bool compact();
+
+    // How long the constructor took to read the index and replay the log
+    double getOpenMilliseconds() const;
+    int getNumLogRecords() const;
+
+private:
+    enum RecordType : uint8 { putRecord = 1, removeRecord = 2 };
+
+    // Reads whichever part of the library each file holds, false if the file is unusable
+    bool loadIndex();
+    bool replayLog(int64& validLogSize);
+    void openLogForAppending(int64 validLogSize);
+    bool writeLogRecord(const MemoryBlock& payload);
+    bool writeLogHeader(OutputStream& stream) const;
+    void compactIfLogIsLarge();
+
+    void applyPut(const Track& track);
+    void applyRemove(const File& file);
+
+    static void writeTrack(OutputStream& stream, const Track& track);
+    static bool readTrack(InputStream& stream, Track& track);
+
+    File indexFile;
+    File logFile;
+    std::unique_ptr<FileOutputStream> logStream;
+    uint64 generation = 0;   // Bumped by every compaction, the log must match the index
+    int numLogRecords = 0;
+    double openMilliseconds = 0.0;
+
+    std::vector<Track> tracks;
+    std::unordered_map<String, int> indexByPath;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackLibrary)
+};
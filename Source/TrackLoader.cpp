@@ -0,0 +1,205 @@
+#include "TrackLoader.h"
+
+double TrackLoader::Ticket::getProgress() const
+{
+    return progress;
+}
+
+void TrackLoader::Ticket::cancel()
+{
+    cancelled = true;
+}
+
+bool TrackLoader::Ticket::isCancelled() const
+{
+    return cancelled;
+}
+
+//==============================================================================
+TrackLoader::TrackLoader(AudioFormatManager& _formatManager, DeckStreamingService& _streamingService)
+    : formatManager(_formatManager),
+      streamingService(_streamingService),
+      pool(jlimit(1, 4, SystemStats::getNumCpus() / 2))
+{
+}
+
+TrackLoader::~TrackLoader()
+{
+    // Make running jobs bail out at their next checkpoint and wait for them
+    shuttingDown = true;
+    pool.removeAllJobs(true, 5000);
+
+    // Tracks still waiting in callAsync would outlive the streaming service their
+    // sources run on, so free them now and let the queued callbacks find nothing
+    const ScopedLock sl(pendingLock);
+    for (auto& pending : pendingLoads)
+    {
+        if (auto load = pending.lock())
+        {
+            load->ticket->cancel();
+            load->track.reset();
+            load->thumbnailReader.reset();
+        }
+    }
+}
+
+void TrackLoader::deliver(std::shared_ptr<PendingLoad> load, DeckLoadCallback onFinished)
+{
+    {
+        const ScopedLock sl(pendingLock);
+        pendingLoads.erase(std::remove_if(pendingLoads.begin(), pendingLoads.end(),
+            [](const std::weak_ptr<PendingLoad>& pending) { return pending.expired(); }),
+            pendingLoads.end());
+        pendingLoads.push_back(load);
+    }
+
+    // The callback owns the result, so it is freed as soon as it has run
+    MessageManager::callAsync([load, onFinished]
+    {
+        // Whoever cancelled may already be gone, so only call back for live jobs
+        if (!load->ticket->isCancelled())
+            onFinished(std::move(load->track), std::move(load->thumbnailReader), load->error);
+    });
+}
+
+AudioFormatReader* TrackLoader::createReader(const URL& audioURL)
+{
+    if (audioURL.isLocalFile())
+        return formatManager.createReaderFor(audioURL.getLocalFile());
+
+    return formatManager.createReaderFor(audioURL.createInputStream(false));
+}
+
+MemoryMappedAudioFormatReader* TrackLoader::createMemoryMappedReader(const URL& audioURL)
+{
+    if (!audioURL.isLocalFile())
+        return nullptr;
+
+    auto file = audioURL.getLocalFile();
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+    // Compressed formats don't support mapping and return nullptr here
+    std::unique_ptr<MemoryMappedAudioFormatReader> reader(
+        format != nullptr ? format->createMemoryMappedReader(file) : nullptr);
+
+    // Mapping can still fail, e.g. when the address space is too small for the file
+    if (reader == nullptr || !reader->mapEntireFile())
+        return nullptr;
+
+    return reader.release();
+}
+
+void TrackLoader::setMemoryMappingEnabled(bool shouldBeEnabled)
+{
+    memoryMappingEnabled = shouldBeEnabled;
+}
+
+bool TrackLoader::isMemoryMappingEnabled() const
+{
+    return memoryMappingEnabled;
+}
+
+TrackLoader::TicketPtr TrackLoader::loadForDeck(const URL& audioURL,
+    int readAheadSamples,
+    int samplesPerBlockExpected,
+    double sampleRate,
+    DeckLoadCallback onFinished)
+{
+    auto ticket = std::make_shared<Ticket>();
+
+    pool.addJob([this, ticket, audioURL, readAheadSamples, samplesPerBlockExpected, sampleRate, onFinished]
+    {
+        // std::function needs copyable captures, so the results travel in a shared holder
+        auto result = std::make_shared<PendingLoad>();
+        result->ticket = ticket;
+
+        auto shouldStop = [this, ticket] { return ticket->isCancelled() || shuttingDown; };
+
+        // Open and validate the file
+        std::unique_ptr<AudioFormatReader> reader(createReader(audioURL));
+        if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0 || reader->numChannels == 0)
+        {
+            result->error = "Unsupported or unreadable audio file";
+            deliver(result, onFinished);
+            return;
+        }
+        ticket->progress = 0.1;
+
+        auto track = std::make_unique<DeckTrack>(audioURL, reader->sampleRate,
+            reader->lengthInSamples, (int)reader->numChannels);
+
+        std::unique_ptr<MemoryMappedAudioFormatReader> mappedReader;
+        if (memoryMappingEnabled)
+            mappedReader.reset(createMemoryMappedReader(audioURL));
+
+        if (mappedReader != nullptr)
+        {
+            // Fault in the pages for the first few seconds, so starting from the top never waits on the disk
+            const int64 touchLength = jmin(mappedReader->lengthInSamples, (int64)(preDecodeSeconds * mappedReader->sampleRate));
+            for (int64 pos = 0; pos < touchLength; pos += 64)
+                mappedReader->touchSample(pos);
+
+            track->setBody(std::make_unique<AudioFormatReaderSource>(mappedReader.release(), true));
+            track->setPlaybackMode(DeckTrack::PlaybackMode::memoryMapped);
+            ticket->progress = 0.8;
+        }
+        else
+        {
+            // Tracks that fit the cache are decoded once and shared by every deck that loads them
+            auto decoded = trackCache->findOrDecode(DecodedTrackCache::makeKey(audioURL), *reader,
+                [&](double progress)
+                {
+                    ticket->progress = jmax((double)ticket->progress, 0.1 + 0.8 * progress);
+                    return !shouldStop();
+                });
+
+            if (shouldStop())
+                return;
+
+            if (decoded != nullptr)
+            {
+                track->setBody(std::make_unique<CachedTrackSource>(decoded));
+                track->setPlaybackMode(DeckTrack::PlaybackMode::cached);
+            }
+            else
+            {
+                // Decode the first few seconds into memory, in small steps so cancelling is quick
+                const int headLength = (int)jmin(reader->lengthInSamples, (int64)(preDecodeSeconds * reader->sampleRate));
+                const int chunkSize = jmax(1, (int)(reader->sampleRate / 4));
+                AudioBuffer<float> head((int)reader->numChannels, headLength);
+
+                for (int pos = 0; pos < headLength; pos += chunkSize)
+                {
+                    if (shouldStop())
+                        return;
+
+                    const int numThisTime = jmin(chunkSize, headLength - pos);
+                    reader->read(&head, pos, numThisTime, pos, true, true);
+                    ticket->progress = 0.1 + 0.7 * (double)(pos + numThisTime) / (double)headLength;
+                }
+                track->setHead(std::move(head));
+
+                // The rest of the file is streamed from a worker thread during playback
+                track->setBody(std::unique_ptr<PositionableAudioSource>(
+                    streamingService.createSource(new AudioFormatReaderSource(reader.release(), true), readAheadSamples)));
+                track->setPlaybackMode(DeckTrack::PlaybackMode::streamed);
+            }
+        }
+
+        // Preparing fills the read-ahead buffer, so the deck can start without waiting
+        if (sampleRate > 0.0)
+            track->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+        if (shouldStop())
+            return;
+        ticket->progress = 0.9;
+
+        // The waveform gets its own reader, it scans the file on the thumbnail thread
+        result->thumbnailReader.reset(createReader(audioURL));
+        result->track = std::move(track);
+        ticket->progress = 1.0;
+        deliver(result, onFinished);
+    });
+
+    return ticket;
+}
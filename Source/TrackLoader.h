@@ -0,0 +1,94 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DeckTrack.h"
+#include "DeckStreamingService.h"
+#include "DecodedTrackCache.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Opens, validates and pre-decodes tracks on worker threads, so large files
+ * or slow network mounts never block the message thread.
+ * Uncompressed local files (WAV, AIFF) are memory-mapped and read in place.
+ * Other tracks that fit the decoded-track cache are decoded whole and played
+ * from memory; anything bigger is streamed from disk behind a pre-decoded head.
+ * Results are delivered back on the message thread; any job can be cancelled
+ * through the ticket returned when it was started.
+ */
+class TrackLoader {
+public:
+    // Shared between a running job and whoever started it
+    class Ticket {
+    public:
+        // 0.0 to 1.0, safe to poll from the message thread
+        double getProgress() const;
+
+        // Stops the job at its next checkpoint and drops its result
+        void cancel();
+        bool isCancelled() const;
+
+    private:
+        friend class TrackLoader;
+        std::atomic<double> progress{ 0.0 };
+        std::atomic<bool> cancelled{ false };
+    };
+
+    using TicketPtr = std::shared_ptr<Ticket>;
+
+    // Called on the message thread with the prepared track and a second reader for the
+    // waveform, or with null pointers and an error message when loading failed
+    using DeckLoadCallback = std::function<void(std::unique_ptr<DeckTrack> track,
+        std::unique_ptr<AudioFormatReader> thumbnailReader,
+        const String& error)>;
+
+    // Seconds decoded into memory before the track is handed to a deck
+    static constexpr double preDecodeSeconds = 4.0;
+
+    TrackLoader(AudioFormatManager& formatManager, DeckStreamingService& streamingService);
+    ~TrackLoader();
+
+    // Builds a track ready for a deck. The block size and sample rate are the deck's
+    // current playback settings (0 if the deck isn't prepared yet).
+    TicketPtr loadForDeck(const URL& audioURL,
+        int readAheadSamples,
+        int samplesPerBlockExpected,
+        double sampleRate,
+        DeckLoadCallback onFinished);
+
+    // On by default, turning it off sends WAV/AIFF files down the cache or streaming path
+    void setMemoryMappingEnabled(bool shouldBeEnabled);
+    bool isMemoryMappingEnabled() const;
+
+private:
+    // A finished job's track on its way to the message thread
+    struct PendingLoad {
+        TicketPtr ticket;
+        std::unique_ptr<DeckTrack> track;
+        std::unique_ptr<AudioFormatReader> thumbnailReader;
+        String error;
+    };
+
+    // Hands a finished job to the message thread, remembering it until it gets there
+    void deliver(std::shared_ptr<PendingLoad> load, DeckLoadCallback onFinished);
+
+    AudioFormatReader* createReader(const URL& audioURL);
+    // Returns a mapped reader for uncompressed local files, nullptr for anything else
+    MemoryMappedAudioFormatReader* createMemoryMappedReader(const URL& audioURL);
+
+    AudioFormatManager& formatManager;
+    DeckStreamingService& streamingService;
+    SharedResourcePointer<DecodedTrackCache> trackCache;
+    std::atomic<bool> memoryMappingEnabled{ true };
+    std::atomic<bool> shuttingDown{ false };
+
+    // Results still queued on the message thread, freed on shutdown while the streaming service is alive
+    CriticalSection pendingLock;
+    std::vector<std::weak_ptr<PendingLoad>> pendingLoads;
+
+    // Declared last so it is destroyed first, waiting for running jobs
+    ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackLoader)
+};
@@ -0,0 +1,161 @@
+#include "WaveformDiskCache.h"
+#include <algorithm>
+
+WaveformDiskCache::WaveformDiskCache()
+    : directory(File::getSpecialLocation(File::userApplicationDataDirectory)
+        .getChildFile("OtoDecks").getChildFile("WaveformCache"))
+{
+    directory.createDirectory();
+
+    // Pick up what earlier runs left behind, minus any half-written files
+    for (auto& file : directory.findChildFiles(File::findFiles, false, "*" + String(partialExtension)))
+        file.deleteFile();
+
+    for (auto& file : findCacheFiles())
+    {
+        ++numFiles;
+        bytesOnDisk += file.getSize();
+    }
+}
+
+WaveformDiskCache::~WaveformDiskCache()
+{
+}
+
+String WaveformDiskCache::makeKey(const File& audioFile)
+{
+    return audioFile.getFullPathName() + "|" + String(audioFile.getSize())
+        + "|" + String(audioFile.getLastModificationTime().toMilliseconds());
+}
+
+File WaveformDiskCache::getCacheFile(const String& key) const
+{
+    // The key itself is stored in the file, so a hash collision is caught on loading
+    return directory.getChildFile(String::toHexString(key.hashCode64()) + cacheExtension);
+}
+
+Array<File> WaveformDiskCache::findCacheFiles() const
+{
+    // Files still being written have their own extension, so they are never counted or trimmed
+    return directory.findChildFiles(File::findFiles, false, "*" + String(cacheExtension));
+}
+
+WaveformDiskCache::PyramidPtr WaveformDiskCache::find(const File& audioFile)
+{
+    const String key = makeKey(audioFile);
+    const File cacheFile = getCacheFile(key);
+
+    PyramidPtr pyramid;
+    if (cacheFile.existsAsFile())
+        pyramid = WaveformPyramid::loadMapped(cacheFile, key);
+
+    const ScopedLock sl(lock);
+    if (pyramid == nullptr)
+    {
+        ++misses;
+        return nullptr;
+    }
+
+    // The modification time doubles as the last use, for evicting
+    ++hits;
+    cacheFile.setLastModificationTime(Time::getCurrentTime());
+    return pyramid;
+}
+
+void WaveformDiskCache::store(const File& audioFile, const WaveformPyramid& pyramid)
+{
+    const String key = makeKey(audioFile);
+    const File cacheFile = getCacheFile(key);
+
+    // Written next to the target and moved over it, so a reader never maps a half-written file
+    TemporaryFile temporary(cacheFile, directory.getNonexistentChildFile(cacheFile.getFileNameWithoutExtension()
+        + "_" + String::toHexString(Random::getSystemRandom().nextInt()), partialExtension, false));
+    {
+        std::unique_ptr<FileOutputStream> stream(temporary.getFile().createOutputStream());
+        if (stream == nullptr || !pyramid.writeTo(*stream, key))
+            return;
+    }
+
+    const ScopedLock sl(lock);
+    const int64 oldSize = cacheFile.existsAsFile() ? cacheFile.getSize() : -1;
+    if (!temporary.overwriteTargetFileWithTemporary())
+        return;
+
+    if (oldSize >= 0)
+        bytesOnDisk -= oldSize;
+    else
+        ++numFiles;
+    bytesOnDisk += cacheFile.getSize();
+
+    trimToBudget();
+}
+
+void WaveformDiskCache::trimToBudget()
+{
+    if (bytesOnDisk <= byteBudget)
+        return;
+
+    Array<File> files = findCacheFiles();
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b)
+    {
+        return a.getLastModificationTime() < b.getLastModificationTime();
+    });
+
+    // Files that are mapped right now may refuse to go on some systems, they stay counted
+    for (auto& file : files)
+    {
+        if (bytesOnDisk <= byteBudget)
+            break;
+
+        const int64 size = file.getSize();
+        if (file.deleteFile())
+        {
+            bytesOnDisk -= size;
+            --numFiles;
+        }
+    }
+}
+
+void WaveformDiskCache::setByteBudget(int64 numBytes)
+{
+    const ScopedLock sl(lock);
+    byteBudget = jmax((int64)0, numBytes);
+    trimToBudget();
+}
+
+int64 WaveformDiskCache::getByteBudget() const
+{
+    const ScopedLock sl(lock);
+    return byteBudget;
+}
+
+WaveformDiskCache::Stats WaveformDiskCache::getStats() const
+{
+    const ScopedLock sl(lock);
+    Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.numFiles = numFiles;
+    stats.bytesOnDisk = bytesOnDisk;
+    stats.byteBudget = byteBudget;
+    return stats;
+}
+
+void WaveformDiskCache::clear()
+{
+    const ScopedLock sl(lock);
+    for (auto& file : findCacheFiles())
+    {
+        const int64 size = file.getSize();
+        if (file.deleteFile())
+        {
+            bytesOnDisk -= size;
+            --numFiles;
+        }
+    }
+}
+
+const File& WaveformDiskCache::getDirectory() const
+{
+    return directory;
+}
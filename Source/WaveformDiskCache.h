@@ -0,0 +1,67 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "WaveformPyramid.h"
+#include <memory>
+
+/**
+ * Keeps waveform pyramids on disk between runs, one small file per track in
+ * the app data folder, so a track that was scanned once shows its waveform
+ * straight away the next time. Files are memory-mapped on loading, nothing is
+ * decoded or copied. Tracks are keyed by path, size and modification time,
+ * so an edited file is scanned again. Least recently used files are deleted
+ * to stay within a byte budget.
+ * Safe to use from any thread. Use through SharedResourcePointer<WaveformDiskCache>.
+ */
+class WaveformDiskCache {
+public:
+    using PyramidPtr = std::shared_ptr<const WaveformPyramid>;
+
+    struct Stats {
+        int hits = 0;
+        int misses = 0;
+        int numFiles = 0;
+        int64 bytesOnDisk = 0;
+        int64 byteBudget = 0;
+    };
+
+    static constexpr int64 defaultByteBudget = (int64)256 * 1024 * 1024;
+
+    WaveformDiskCache();
+    ~WaveformDiskCache();
+
+    // Cache key for a track: full path, size and modification time
+    static String makeKey(const File& audioFile);
+
+    // The stored pyramid for the track, or nullptr (counted as a miss)
+    PyramidPtr find(const File& audioFile);
+    // Writes the track's pyramid, replacing an older one, then trims to the budget
+    void store(const File& audioFile, const WaveformPyramid& pyramid);
+
+    // Shrinking the budget deletes files straight away
+    void setByteBudget(int64 numBytes);
+    int64 getByteBudget() const;
+    Stats getStats() const;
+    // Deletes every cache file
+    void clear();
+
+    const File& getDirectory() const;
+
+private:
+    static constexpr const char* cacheExtension = ".otw";
+    static constexpr const char* partialExtension = ".otw-part";
+
+    File getCacheFile(const String& key) const;
+    Array<File> findCacheFiles() const;
+    // Deletes the least recently used files until the cache fits its budget (lock held)
+    void trimToBudget();
+
+    File directory;
+    mutable CriticalSection lock;
+    int hits = 0;
+    int misses = 0;
+    int numFiles = 0;
+    int64 bytesOnDisk = 0;
+    int64 byteBudget = defaultByteBudget;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformDiskCache)
+};
@@ -1,41 +1,62 @@
 #include "WaveformDisplay.h"
 
-WaveformDisplay::WaveformDisplay(AudioFormatManager& formatManagerToUse,
-        AudioThumbnailCache& thumbCacheToUse) : audioThumb(1000, formatManagerToUse, thumbCacheToUse), fileLoaded(false), position(0.0)
+WaveformDisplay::WaveformDisplay() : fileLoaded(false), position(0.0)
 {
-    audioThumb.addChangeListener(this);
+    // Every pixel is painted, so repainting the playhead never reaches the deck behind
+    setOpaque(true);
 }
 
 WaveformDisplay::~WaveformDisplay()
 {
+    cancelBuild();
 }
 
 void WaveformDisplay::paint(Graphics& g)
 {
-    g.setColour(Colour(0xFF0B0F13)); // Darker background
-    g.fillAll();
-
-    if (fileLoaded)
+    if (fileLoaded && pyramid == nullptr)
+    {
+        g.fillAll(Colour(0xFF0B0F13));
+        g.setColour(Colour(0xFFaaaaaa));
+        g.setFont(14.0f);
+        g.drawText("Scanning waveform...", getLocalBounds(), Justification::centred, true);
+    }
+    else if (fileLoaded)
     {
         // Create a slightly inset area for the waveform
         auto bounds = getLocalBounds().reduced(2);
-        auto midPoint = bounds.getCentreY();
+        const View view = getView();
+        const double samplesPerPixel = view.visibleSamples / jmax(1, bounds.getWidth());
 
-        // Draw the main waveform using AudioThumbnail
-        g.setColour(Colour(0xFFf5a623).withAlpha(0.7f));
-        audioThumb.drawChannel(g, bounds, 0.0, audioThumb.getTotalLength(), 0, 0.8f); // Scaling factor 0.8f for less extreme
+        // The waveform itself comes from the cached layer, only the playhead is drawn every time
+        if (!view.zoomed)
+        {
+            if (!layerValid)
+                renderLayer(getWidth(), 0.0, samplesPerPixel, true);
+            g.drawImageAt(waveformLayer, 0, 0);
+        }
+        else
+        {
+            // A zoomed view scrolls across a layer three views wide, drawn again once it runs out
+            int scroll = roundToInt((view.startSample - layerStartSample) / samplesPerPixel);
+            if (!layerValid || samplesPerPixel != layerSamplesPerPixel
+                || scroll < 0 || scroll > 2 * bounds.getWidth())
+            {
+                renderLayer(3 * bounds.getWidth() + 2 * bounds.getX(),
+                    view.startSample - bounds.getWidth() * samplesPerPixel, samplesPerPixel, false);
+                scroll = bounds.getWidth();
+            }
 
-        // Add a stylized effect underneath for visual richness
-        drawStylizedWaveformBase(g, bounds);
+            g.fillAll(Colour(0xFF0B0F13));
+            Graphics::ScopedSaveState state(g);
+            g.reduceClipRegion(bounds);
+            g.drawImageAt(waveformLayer, -scroll, 0);
+        }
 
-        // Calculate playhead position
-        int playheadX = bounds.getX() + position * bounds.getWidth();
-
-        // Draw playhead line (vertical line showing current position)
+        // Playhead line (vertical line showing current position) with a small triangle on top
+        const int playheadX = getPlayheadX(view);
         g.setColour(Colours::white);
         g.drawLine(playheadX, bounds.getY(), playheadX, bounds.getBottom(), 2.0f);
 
-        // Draw playhead indicator at the top (small triangle)
         Path triangle;
         float triangleSize = 8.0f;
         triangle.addTriangle(playheadX - triangleSize / 2, bounds.getY(),
@@ -43,26 +64,109 @@ void WaveformDisplay::paint(Graphics& g)
                             playheadX, bounds.getY() + triangleSize);
         g.fillPath(triangle);
 
-        // Draw time indicators
-        g.setColour(Colour(0xFFaaaaaa));
-        g.setFont(12.0f);
-        g.drawText("0:00", 5, bounds.getBottom() - 15, 50, 15, Justification::left, false);
-
-        // Calculate and display total time
-        double totalSeconds = audioThumb.getTotalLength();
-        int minutes = (int)(totalSeconds / 60);
-        int seconds = (int)(totalSeconds) % 60;
-        String timeString = String::formatted("%d:%02d", minutes, seconds);
-        g.drawText(timeString, bounds.getWidth() - 50, bounds.getBottom() - 15, 45, 15, Justification::right, false);
+        // The time range of a zoomed view moves with the playhead
+        if (view.zoomed)
+            drawTimeLabels(g, bounds, view.startSample, view.visibleSamples);
     }
     else {
         // Message when no file is loaded
+        g.fillAll(Colour(0xFF0B0F13));
         g.setColour(Colour(0xFFaaaaaa)); // Light gray text
         g.setFont(16.0f);
         g.drawText("No track loaded", getLocalBounds(), Justification::centred, true);
     }
 }
 
+void WaveformDisplay::renderLayer(int width, double startSample, double samplesPerPixel, bool withTimeLabels)
+{
+    if (waveformLayer.getWidth() != width || waveformLayer.getHeight() != getHeight())
+        waveformLayer = Image(Image::RGB, jmax(1, width), jmax(1, getHeight()), false);
+
+    Graphics g(waveformLayer);
+    g.fillAll(Colour(0xFF0B0F13)); // Darker background
+
+    const auto bounds = Rectangle<int>(width, getHeight()).reduced(2);
+    const float midPoint = (float)bounds.getCentreY();
+    const int numColumns = jmin(bounds.getWidth(), (int)columns.size());
+
+    // Draw the main waveform from the pyramid, one column per pixel: peaks, then RMS on top
+    pyramid->getColumns(startSample, samplesPerPixel, columns.data(), numColumns);
+    const float halfHeight = bounds.getHeight() * 0.5f * 0.8f; // Scaling factor 0.8f for less extreme
+
+    g.setColour(Colour(0xFFf5a623).withAlpha(0.7f));
+    for (int x = 0; x < numColumns; ++x)
+    {
+        const auto& column = columns[(size_t)x];
+        const float top = midPoint - column.max * halfHeight;
+        g.fillRect((float)(bounds.getX() + x), top, 1.0f, jmax(1.0f, (column.max - column.min) * halfHeight));
+    }
+
+    g.setColour(Colour(0xFFffd27a).withAlpha(0.8f));
+    for (int x = 0; x < numColumns; ++x)
+    {
+        const float rms = columns[(size_t)x].rms * halfHeight;
+        g.fillRect((float)(bounds.getX() + x), midPoint - rms, 1.0f, 2.0f * rms);
+    }
+
+    // Add a stylized effect underneath for visual richness
+    drawStylizedWaveformBase(g, bounds);
+
+    if (withTimeLabels)
+        drawTimeLabels(g, bounds, startSample, samplesPerPixel * bounds.getWidth());
+
+    layerValid = true;
+    layerStartSample = startSample;
+    layerSamplesPerPixel = samplesPerPixel;
+}
+
+void WaveformDisplay::drawTimeLabels(Graphics& g, Rectangle<int> bounds, double startSample, double visibleSamples)
+{
+    // Time indicators for both edges of the visible range
+    auto formatTime = [](double timeInSeconds)
+    {
+        const int totalSeconds = jmax(0, (int)timeInSeconds);
+        return String::formatted("%d:%02d", totalSeconds / 60, totalSeconds % 60);
+    };
+    const double sampleRate = pyramid->getSampleRate();
+    g.setColour(Colour(0xFFaaaaaa));
+    g.setFont(12.0f);
+    g.drawText(formatTime(startSample / sampleRate), 5, bounds.getBottom() - 15, 50, 15, Justification::left, false);
+    g.drawText(formatTime((startSample + visibleSamples) / sampleRate), bounds.getWidth() - 50, bounds.getBottom() - 15, 45, 15, Justification::right, false);
+}
+
+WaveformDisplay::View WaveformDisplay::getView() const
+{
+    // Visible range: the whole track, or zoomSeconds centred on the playhead
+    View view;
+    if (pyramid == nullptr)
+        return view;
+
+    const double totalSamples = (double)pyramid->getLengthInSamples();
+    view.zoomed = zoomSeconds > 0.0 && zoomSeconds < pyramid->getLengthInSeconds();
+    view.visibleSamples = view.zoomed ? zoomSeconds * pyramid->getSampleRate() : totalSamples;
+    view.startSample = view.zoomed ? position * totalSamples - view.visibleSamples / 2 : 0.0;
+    return view;
+}
+
+int WaveformDisplay::getPlayheadX(const View& view) const
+{
+    // The playhead stays in the middle while zoomed
+    const auto bounds = getLocalBounds().reduced(2);
+    return bounds.getX() + (int)((view.zoomed ? 0.5 : position) * bounds.getWidth());
+}
+
+Rectangle<int> WaveformDisplay::getPlayheadArea(int playheadX) const
+{
+    // Covers the 2px line and the 8px triangle with a pixel to spare for antialiasing
+    return { playheadX - 6, 0, 13, getHeight() };
+}
+
+void WaveformDisplay::invalidateLayer()
+{
+    layerValid = false;
+    repaint();
+}
+
 void WaveformDisplay::drawStylizedWaveformBase(Graphics& g, Rectangle<int> bounds)
 {
     // Draw a smooth base under the actual waveform
@@ -95,30 +199,109 @@ void WaveformDisplay::drawStylizedWaveformBase(Graphics& g, Rectangle<int> bound
 
 void WaveformDisplay::resized()
 {
+    // Sized here so painting never allocates, a zoomed layer is three views wide
+    columns.resize((size_t)jmax(0, 3 * getWidth()));
+    invalidateLayer();
+}
+
+void WaveformDisplay::mouseWheelMove(const MouseEvent&, const MouseWheelDetails& wheel)
+{
+    if (pyramid == nullptr || wheel.deltaY == 0.0f)
+        return;
+
+    // Scrolling up zooms in; zooming out past the whole track goes back to the overview
+    const double totalSeconds = pyramid->getLengthInSeconds();
+    const double current = zoomSeconds > 0.0 ? zoomSeconds : totalSeconds;
+    const double zoomed = current * (wheel.deltaY > 0.0f ? 0.8 : 1.25);
+    setZoomSeconds(zoomed >= totalSeconds ? 0.0 : jmax(minZoomSeconds, zoomed));
+}
+
+void WaveformDisplay::mouseDoubleClick(const MouseEvent&)
+{
+    setZoomSeconds(0.0);
+}
+
+void WaveformDisplay::setZoomSeconds(double seconds)
+{
+    zoomSeconds = jmax(0.0, seconds);
+    invalidateLayer();
+}
+
+double WaveformDisplay::getZoomSeconds() const
+{
+    return zoomSeconds;
 }
 
-void WaveformDisplay::loadURL(URL audioURL)
+void WaveformDisplay::cancelBuild()
 {
-    audioThumb.clear();
-    fileLoaded = audioThumb.setSource(new URLInputSource(audioURL));
+    if (buildCancelled != nullptr)
+        *buildCancelled = true;
+    buildCancelled = nullptr;
+}
+
+void WaveformDisplay::loadReader(AudioFormatReader* reader, const URL& audioURL)
+{
+    cancelBuild();
+    pyramid = nullptr;
+    layerValid = false;
+
+    // The pyramid is scanned once per track on a worker thread, then kept on disk
+    fileLoaded = reader != nullptr;
     if (fileLoaded)
     {
         position = 0.0;
-    }
 
-    repaint();
-}
+        // Tracks seen before come from the disk cache straight away
+        pyramid = pyramidBuilder->findCached(audioURL);
+        if (pyramid != nullptr)
+        {
+            delete reader;
+            repaint();
+            return;
+        }
+
+        buildCancelled = pyramidBuilder->build(std::unique_ptr<AudioFormatReader>(reader), audioURL,
+            [this](WaveformPyramidBuilder::PyramidPtr builtPyramid)
+            {
+                buildCancelled = nullptr;
+                pyramid = builtPyramid;
+                fileLoaded = pyramid != nullptr;
+                invalidateLayer();
+            });
+    }
 
-void WaveformDisplay::changeListenerCallback(ChangeBroadcaster* source)
-{
     repaint();
 }
 
 void WaveformDisplay::setPositionRelative(double pos)
 {
-    if (pos != position && !std::isnan(pos))
+    if (pos == position || std::isnan(pos))
+        return;
+
+    position = pos;
+    if (pyramid == nullptr)
+        return;
+
+    const View view = getView();
+    if (view.zoomed)
     {
-        position = pos;
-        repaint();
+        // The whole view scrolls, but only once it has moved by a pixel
+        const double samplesPerPixel = view.visibleSamples / jmax(1, getWidth() - 4);
+        const int64 scrollPixel = (int64)std::floor(view.startSample / samplesPerPixel);
+        if (scrollPixel != paintedScrollPixel)
+        {
+            paintedScrollPixel = scrollPixel;
+            repaint();
+        }
+        return;
     }
-}
\ No newline at end of file
+
+    // Only the strips under the old and new playhead change
+    const int playheadX = getPlayheadX(view);
+    if (playheadX != paintedPlayheadX)
+    {
+        repaint(getPlayheadArea(paintedPlayheadX));
+        repaint(getPlayheadArea(playheadX));
+        paintedPlayheadX = playheadX;
+    }
+}
@@ -1,28 +1,72 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "WaveformPyramid.h"
+#include <vector>
 /**
  * Component that displays a waveform visualization of an audio file.
  * Shows playback position and allows for visual tracking of the current track.
+ * The waveform comes from a WaveformPyramid built off the message thread, so
+ * the whole track or a zoomed, scrolling view around the playhead costs the
+ * same to draw. Mouse wheel zooms, double-click goes back to the whole track.
+ * The waveform is drawn once into a cached image; while the whole track is
+ * shown, a moving playhead only repaints the strips it leaves and enters.
  */
-class WaveformDisplay : public Component,
-    public ChangeListener
+class WaveformDisplay : public Component
 {
 public:
-    WaveformDisplay(AudioFormatManager& formatManagerToUse,
-        AudioThumbnailCache& thumbCacheToUse);
+    WaveformDisplay();
     ~WaveformDisplay() override;
 
     void paint(Graphics& g) override;
     void resized() override;
-    void changeListenerCallback(ChangeBroadcaster* source) override;
-    void loadURL(URL audioURL);
+    void mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel) override;
+    void mouseDoubleClick(const MouseEvent& event) override;
+    // Takes ownership of an already opened reader, so nothing is opened on the message thread
+    void loadReader(AudioFormatReader* reader, const URL& audioURL);
     void setPositionRelative(double pos);
+    // Seconds shown across the display, centred on the playhead (0 = whole track)
+    void setZoomSeconds(double seconds);
+    double getZoomSeconds() const;
     // Helper method for enhanced waveform visual effect
     void drawStylizedWaveformBase(Graphics& g, Rectangle<int> bounds);
 private:
-    AudioThumbnail audioThumb;
+    static constexpr double minZoomSeconds = 1.0;
+
+    // Part of the track shown across the display
+    struct View {
+        double startSample = 0.0;
+        double visibleSamples = 0.0;
+        bool zoomed = false;
+    };
+
+    // Stops a running pyramid build and drops its result
+    void cancelBuild();
+    View getView() const;
+    int getPlayheadX(const View& view) const;
+    Rectangle<int> getPlayheadArea(int playheadX) const;
+    // Draws background, waveform and (for the whole track) time labels into waveformLayer
+    void renderLayer(int width, double startSample, double samplesPerPixel, bool withTimeLabels);
+    void drawTimeLabels(Graphics& g, Rectangle<int> bounds, double startSample, double visibleSamples);
+    // Redraws the layer on the next paint
+    void invalidateLayer();
+
+    SharedResourcePointer<WaveformPyramidBuilder> pyramidBuilder;
+    WaveformPyramidBuilder::CancelFlag buildCancelled;
+    WaveformPyramidBuilder::PyramidPtr pyramid;
+    std::vector<WaveformPyramid::Column> columns;  // One per pixel, sized in resized()
+
+    // Everything but the playhead, drawn again only when the track, zoom or size changes
+    // or a zoomed view has scrolled off it
+    Image waveformLayer;
+    bool layerValid = false;
+    double layerStartSample = 0.0;
+    double layerSamplesPerPixel = 0.0;
+    int paintedPlayheadX = 0;
+    int64 paintedScrollPixel = 0;
+
     bool fileLoaded;
     double position;
+    double zoomSeconds = 0.0;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformDisplay)
-};
\ No newline at end of file
+};
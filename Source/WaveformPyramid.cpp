@@ -0,0 +1,311 @@
+#include "WaveformPyramid.h"
+#include "WaveformDiskCache.h"
+#include <cstring>
+
+namespace
+{
+    int8 toPeakByte(float value)
+    {
+        return (int8)jlimit(-127, 127, roundToInt(value * 127.0f));
+    }
+
+    uint8 toRmsByte(float value)
+    {
+        return (uint8)jlimit(0, 255, roundToInt(value * 255.0f));
+    }
+}
+
+std::vector<int64> WaveformPyramid::getLevelSizes(int64 length)
+{
+    std::vector<int64> sizes{ (jmax((int64)0, length) + baseSamplesPerBin - 1) / baseSamplesPerBin };
+    while (sizes.back() > 1)
+        sizes.push_back((sizes.back() + 1) / 2);
+    return sizes;
+}
+
+void WaveformPyramid::setLevels(const Bin* firstBin, const std::vector<int64>& levelSizes)
+{
+    levels.clear();
+    for (auto numBins : levelSizes)
+    {
+        levels.push_back({ firstBin, numBins });
+        firstBin += numBins;
+    }
+}
+
+std::shared_ptr<WaveformPyramid> WaveformPyramid::build(AudioFormatReader& reader, const std::function<bool()>& shouldStop)
+{
+    auto pyramid = std::make_shared<WaveformPyramid>();
+    pyramid->sampleRate = reader.sampleRate;
+    pyramid->lengthInSamples = jmax((int64)0, reader.lengthInSamples);
+
+    // All levels go back to back in one block, the base level first
+    const auto levelSizes = getLevelSizes(pyramid->lengthInSamples);
+    int64 totalBins = 0;
+    for (auto numBins : levelSizes)
+        totalBins += numBins;
+    pyramid->storage.resize((size_t)totalBins);
+    Bin* baseLevel = pyramid->storage.data();
+
+    const int numChannels = jmax(1, (int)reader.numChannels);
+
+    // Read in large chunks that hold a whole number of bins
+    const int chunkSize = baseSamplesPerBin * 1024;
+    AudioBuffer<float> chunk(numChannels, chunkSize);
+    size_t binIndex = 0;
+
+    for (int64 pos = 0; pos < pyramid->lengthInSamples; pos += chunkSize)
+    {
+        if (shouldStop())
+            return nullptr;
+
+        const int numThisTime = (int)jmin((int64)chunkSize, pyramid->lengthInSamples - pos);
+        reader.read(&chunk, 0, numThisTime, pos, true, true);
+
+        for (int start = 0; start < numThisTime; start += baseSamplesPerBin)
+        {
+            const int count = jmin(baseSamplesPerBin, numThisTime - start);
+            float low = 1.0f, high = -1.0f;
+            double sumOfSquares = 0.0;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                const float* samples = chunk.getReadPointer(channel, start);
+                auto range = FloatVectorOperations::findMinAndMax(samples, count);
+                low = jmin(low, range.getStart());
+                high = jmax(high, range.getEnd());
+
+                for (int i = 0; i < count; ++i)
+                    sumOfSquares += samples[i] * samples[i];
+            }
+
+            Bin& bin = baseLevel[binIndex++];
+            bin.min = toPeakByte(low);
+            bin.max = toPeakByte(high);
+            bin.rms = toRmsByte((float)std::sqrt(sumOfSquares / (count * numChannels)));
+        }
+    }
+
+    // Every level above combines pairs of bins from the one below
+    const Bin* below = baseLevel;
+    Bin* level = baseLevel + levelSizes[0];
+    for (size_t n = 1; n < levelSizes.size(); ++n)
+    {
+        const int64 numBelow = levelSizes[n - 1];
+        for (int64 i = 0; i < levelSizes[n]; ++i)
+        {
+            const Bin& a = below[2 * i];
+            const Bin& b = 2 * i + 1 < numBelow ? below[2 * i + 1] : a;
+
+            level[i].min = jmin(a.min, b.min);
+            level[i].max = jmax(a.max, b.max);
+            level[i].rms = (uint8)roundToInt(std::sqrt(0.5f * ((float)a.rms * a.rms + (float)b.rms * b.rms)));
+        }
+
+        below = level;
+        level += levelSizes[n];
+    }
+
+    pyramid->setLevels(baseLevel, levelSizes);
+    return pyramid;
+}
+
+bool WaveformPyramid::writeTo(OutputStream& stream, const String& sourceKey) const
+{
+    bool ok = stream.write("OTWF", 4)
+        && stream.writeInt((int)fileVersion)
+        && stream.writeDouble(sampleRate)
+        && stream.writeInt64(lengthInSamples)
+        && stream.writeInt(baseSamplesPerBin)
+        && stream.writeInt(getNumLevels())
+        && stream.writeString(sourceKey);
+
+    for (auto& level : levels)
+        ok = ok && stream.writeInt64(level.numBins);
+
+    for (auto& level : levels)
+        ok = ok && stream.write(level.bins, (size_t)level.numBins * sizeof(Bin));
+
+    return ok;
+}
+
+std::shared_ptr<WaveformPyramid> WaveformPyramid::loadMapped(const File& file, const String& sourceKey)
+{
+    auto mapped = std::make_unique<MemoryMappedFile>(file, MemoryMappedFile::readOnly);
+    const auto* data = static_cast<const char*>(mapped->getData());
+    const size_t size = mapped->getSize();
+    if (data == nullptr)
+        return nullptr;
+
+    // Fixed part of the header, then the key as a null-terminated UTF-8 string
+    const size_t fixedHeaderSize = 4 + 4 + 8 + 8 + 4 + 4;
+    if (size < fixedHeaderSize + 1 || std::memcmp(data, "OTWF", 4) != 0
+        || ByteOrder::littleEndianInt(data + 4) != fileVersion
+        || ByteOrder::littleEndianInt(data + 24) != (uint32)baseSamplesPerBin)
+        return nullptr;
+
+    auto pyramid = std::make_shared<WaveformPyramid>();
+    const uint64 sampleRateBits = ByteOrder::littleEndianInt64(data + 8);
+    std::memcpy(&pyramid->sampleRate, &sampleRateBits, sizeof(double));
+    pyramid->lengthInSamples = (int64)ByteOrder::littleEndianInt64(data + 16);
+    const int numLevels = (int)ByteOrder::littleEndianInt(data + 28);
+
+    const char* keyStart = data + fixedHeaderSize;
+    const auto* keyEnd = static_cast<const char*>(std::memchr(keyStart, 0, size - fixedHeaderSize));
+    if (keyEnd == nullptr || String::fromUTF8(keyStart, (int)(keyEnd - keyStart)) != sourceKey)
+        return nullptr;
+
+    // The level sizes follow from the length, so a mismatch means the file is damaged
+    const auto levelSizes = getLevelSizes(pyramid->lengthInSamples);
+    const char* sizesStart = keyEnd + 1;
+    if (numLevels != (int)levelSizes.size()
+        || (size_t)(sizesStart - data) + (size_t)numLevels * 8 > size)
+        return nullptr;
+
+    int64 totalBins = 0;
+    for (int n = 0; n < numLevels; ++n)
+    {
+        if ((int64)ByteOrder::littleEndianInt64(sizesStart + 8 * n) != levelSizes[(size_t)n])
+            return nullptr;
+        totalBins += levelSizes[(size_t)n];
+    }
+
+    const char* binsStart = sizesStart + 8 * numLevels;
+    if ((size_t)(binsStart - data) + (size_t)totalBins * sizeof(Bin) != size)
+        return nullptr;
+
+    // Bins are bytes, so they can be used straight from the mapping
+    pyramid->setLevels(reinterpret_cast<const Bin*>(binsStart), levelSizes);
+    pyramid->mappedFile = std::move(mapped);
+    return pyramid;
+}
+
+double WaveformPyramid::getSampleRate() const
+{
+    return sampleRate;
+}
+
+int64 WaveformPyramid::getLengthInSamples() const
+{
+    return lengthInSamples;
+}
+
+double WaveformPyramid::getLengthInSeconds() const
+{
+    return sampleRate > 0.0 ? (double)lengthInSamples / sampleRate : 0.0;
+}
+
+int WaveformPyramid::getNumLevels() const
+{
+    return (int)levels.size();
+}
+
+size_t WaveformPyramid::getSizeInBytes() const
+{
+    size_t size = 0;
+    for (auto& level : levels)
+        size += (size_t)level.numBins * sizeof(Bin);
+    return size;
+}
+
+void WaveformPyramid::getColumns(double startSample, double samplesPerColumn, Column* columns, int numColumns) const
+{
+    if (levels.empty() || samplesPerColumn <= 0.0)
+    {
+        std::fill(columns, columns + numColumns, Column());
+        return;
+    }
+
+    // The coarsest level whose bins still fit in a column, so each column reads two or three bins
+    size_t levelIndex = 0;
+    while (levelIndex + 1 < levels.size() && (double)((int64)baseSamplesPerBin << (levelIndex + 1)) <= samplesPerColumn)
+        ++levelIndex;
+
+    const Bin* bins = levels[levelIndex].bins;
+    const double binLength = (double)((int64)baseSamplesPerBin << levelIndex);
+    const int64 numBins = levels[levelIndex].numBins;
+
+    for (int i = 0; i < numColumns; ++i)
+    {
+        const double start = startSample + i * samplesPerColumn;
+        const double end = start + samplesPerColumn;
+        Column& column = columns[i];
+        column = Column();
+
+        if (end <= 0.0 || start >= (double)lengthInSamples)
+            continue;
+
+        const int64 firstBin = jlimit((int64)0, numBins - 1, (int64)(jmax(0.0, start) / binLength));
+        const int64 lastBin = jlimit(firstBin + 1, numBins, (int64)std::ceil(end / binLength));
+
+        int low = 127, high = -127;
+        float sumOfSquares = 0.0f;
+        for (int64 b = firstBin; b < lastBin; ++b)
+        {
+            const Bin& bin = bins[b];
+            low = jmin(low, (int)bin.min);
+            high = jmax(high, (int)bin.max);
+            sumOfSquares += (float)bin.rms * bin.rms;
+        }
+
+        column.min = low / 127.0f;
+        column.max = high / 127.0f;
+        column.rms = std::sqrt(sumOfSquares / (float)(lastBin - firstBin)) / 255.0f;
+    }
+}
+
+//==============================================================================
+WaveformPyramidBuilder::WaveformPyramidBuilder()
+    : pool(jlimit(1, 2, SystemStats::getNumCpus() / 2))
+{
+}
+
+WaveformPyramidBuilder::~WaveformPyramidBuilder()
+{
+    // Make running builds bail out at their next chunk, the pool then waits for them
+    shuttingDown = true;
+}
+
+WaveformPyramidBuilder::PyramidPtr WaveformPyramidBuilder::findCached(const URL& audioURL)
+{
+    if (!audioURL.isLocalFile())
+        return nullptr;
+
+    return diskCache->find(audioURL.getLocalFile());
+}
+
+WaveformPyramidBuilder::CancelFlag WaveformPyramidBuilder::build(std::unique_ptr<AudioFormatReader> reader,
+    const URL& audioURL, Callback onFinished)
+{
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    // std::function needs copyable captures
+    std::shared_ptr<AudioFormatReader> sharedReader(reader.release());
+
+    const File sourceFile = audioURL.isLocalFile() ? audioURL.getLocalFile() : File();
+
+    pool.addJob([this, cancelled, sharedReader, sourceFile, onFinished]
+    {
+        auto shouldStop = [this, cancelled] { return cancelled->load() || shuttingDown.load(); };
+
+        std::shared_ptr<WaveformPyramid> pyramid;
+        if (sharedReader != nullptr && sharedReader->lengthInSamples > 0 && sharedReader->numChannels > 0)
+            pyramid = WaveformPyramid::build(*sharedReader, shouldStop);
+
+        // Next time this track loads, its waveform comes straight from disk
+        if (pyramid != nullptr && sourceFile.existsAsFile())
+            diskCache->store(sourceFile, *pyramid);
+
+        if (shouldStop())
+            return;
+
+        MessageManager::callAsync([cancelled, pyramid, onFinished]
+        {
+            // Whoever cancelled may already be gone
+            if (!cancelled->load())
+                onFinished(pyramid);
+        });
+    });
+
+    return cancelled;
+}
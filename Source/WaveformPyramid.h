@@ -0,0 +1,116 @@
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Min/max/RMS summary of a whole track at every zoom level.
+ * Level 0 has one bin per baseSamplesPerBin source samples and each level
+ * above halves the resolution, down to a few bins for the whole track. A
+ * view of any width and zoom is read from the level closest to its
+ * samples-per-pixel, so drawing costs O(pixels) and never touches the audio.
+ * Channels are folded together: the lowest minimum, the highest maximum and
+ * the RMS over all of them. Bins are stored as bytes, like AudioThumbnail.
+ */
+class WaveformPyramid {
+public:
+    static constexpr int baseSamplesPerBin = 64;
+    static constexpr uint32 fileVersion = 1;
+
+    // One displayed column, all values in -1..1 (rms 0..1)
+    struct Column {
+        float min = 0.0f;
+        float max = 0.0f;
+        float rms = 0.0f;
+    };
+
+    WaveformPyramid() = default;
+
+    // Scans the whole track on the calling thread, nullptr if shouldStop returned true
+    static std::shared_ptr<WaveformPyramid> build(AudioFormatReader& reader, const std::function<bool()>& shouldStop);
+
+    double getSampleRate() const;
+    int64 getLengthInSamples() const;
+    double getLengthInSeconds() const;
+    int getNumLevels() const;
+    // Memory used by the bins of all levels
+    size_t getSizeInBytes() const;
+
+    // Compact binary form: a small header, then the bins of every level exactly as they
+    // sit in memory. sourceKey names what was scanned and is checked again on loading.
+    bool writeTo(OutputStream& stream, const String& sourceKey) const;
+    // Maps a file written by writeTo and reads the bins in place, nullptr if the file is
+    // damaged, from another version, or was written for a different sourceKey
+    static std::shared_ptr<WaveformPyramid> loadMapped(const File& file, const String& sourceKey);
+
+    // Fills numColumns columns, column i summarising the source samples from
+    // startSample + i * samplesPerColumn for samplesPerColumn samples.
+    // Columns before the start or past the end of the track come out silent.
+    void getColumns(double startSample, double samplesPerColumn, Column* columns, int numColumns) const;
+
+private:
+    struct Bin {
+        int8 min = 0;
+        int8 max = 0;
+        uint8 rms = 0;
+    };
+    static_assert(sizeof(Bin) == 3, "bins are written to disk and mapped back as they are");
+
+    struct Level {
+        const Bin* bins = nullptr;
+        int64 numBins = 0;
+    };
+
+    // Number of bins in every level for a track length, from the base up to a single bin
+    static std::vector<int64> getLevelSizes(int64 lengthInSamples);
+    // Points the levels at consecutive runs of bins starting at firstBin
+    void setLevels(const Bin* firstBin, const std::vector<int64>& levelSizes);
+
+    double sampleRate = 0.0;
+    int64 lengthInSamples = 0;
+    std::vector<Level> levels;  // levels[n] has baseSamplesPerBin << n samples per bin
+
+    // Where the bins live: built here, or read in place from a cache file
+    std::vector<Bin> storage;
+    std::unique_ptr<MemoryMappedFile> mappedFile;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformPyramid)
+};
+
+class WaveformDiskCache;
+
+/**
+ * Builds waveform pyramids on a small shared worker pool and hands them back
+ * on the message thread. Pyramids of local files are kept in the
+ * WaveformDiskCache, so each track is only scanned once.
+ * Use through SharedResourcePointer<WaveformPyramidBuilder>.
+ */
+class WaveformPyramidBuilder {
+public:
+    using PyramidPtr = std::shared_ptr<const WaveformPyramid>;
+    // Set to stop a build early and drop its result
+    using CancelFlag = std::shared_ptr<std::atomic<bool>>;
+    using Callback = std::function<void(PyramidPtr pyramid)>;
+
+    WaveformPyramidBuilder();
+    ~WaveformPyramidBuilder();
+
+    // The stored pyramid of a local file, nullptr if it has to be built.
+    // Only maps a small file, quick enough for the message thread.
+    PyramidPtr findCached(const URL& audioURL);
+
+    // Takes ownership of the reader. onFinished runs on the message thread with the
+    // pyramid, or with nullptr if the track couldn't be read; never after a cancel.
+    CancelFlag build(std::unique_ptr<AudioFormatReader> reader, const URL& audioURL, Callback onFinished);
+
+private:
+    SharedResourcePointer<WaveformDiskCache> diskCache;
+    std::atomic<bool> shuttingDown{ false };
+
+    // Declared last so it is destroyed first, waiting for running builds
+    ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformPyramidBuilder)
+};